@@ -0,0 +1,363 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "version_compare.h"
+#include "malloc_count.h"
+
+#define BENCH_CORPUS_SIZE 4096
+
+struct bench_corpus {
+    const char *name;
+    char (*version)[64];
+    size_t count;
+};
+
+struct bench_result {
+    const char *name;
+    const char *corpus;
+    size_t ops;
+    double ns;
+    size_t allocs;
+};
+
+typedef size_t (*bench_fn)(const struct bench_corpus *corpus, size_t iterations);
+
+static volatile long bench_sink;
+
+static unsigned bench_random(unsigned *seed) {
+    *seed = *seed * 1103515245 + 12345;
+    return (*seed >> 16) & 0x7fff;
+}
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+static void corpus_semver(char *buf, size_t size, unsigned *seed) {
+    const char *pre[] = {"", "", "", "-rc1", "-beta2", "-alpha"};
+    snprintf(buf, size, "%u.%u.%u%s", bench_random(seed) % 20, bench_random(seed) % 50,
+             bench_random(seed) % 200, pre[bench_random(seed) % 6]);
+}
+
+static void corpus_rpm(char *buf, size_t size, unsigned *seed) {
+    snprintf(buf, size, "%u:%u.%u.%u-%u.el%u", bench_random(seed) % 3, bench_random(seed) % 6,
+             bench_random(seed) % 30, bench_random(seed) % 500, bench_random(seed) % 900, 7 + bench_random(seed) % 3);
+}
+
+static void corpus_pep440(char *buf, size_t size, unsigned *seed) {
+    const char *suffix[] = {"", "", "a1", "b2", "rc1", ".post1", ".dev3"};
+    snprintf(buf, size, "%u.%u%s", 2015 + bench_random(seed) % 10, bench_random(seed) % 13,
+             suffix[bench_random(seed) % 7]);
+}
+
+static void corpus_long(char *buf, size_t size, unsigned *seed) {
+    size_t len = 0;
+    for (int i = 0; i < 12 && len < size; i++) {
+        len += (size_t) snprintf(buf + len, size - len, "%s%u", i ? "." : "", bench_random(seed) % 1000);
+    }
+}
+
+static int corpus_init(struct bench_corpus *corpus, const char *name, void (*gen)(char *, size_t, unsigned *)) {
+    unsigned seed = 1;
+
+    corpus->name = name;
+    corpus->count = BENCH_CORPUS_SIZE;
+    corpus->version = calloc(corpus->count, sizeof(*corpus->version));
+    if (!corpus->version) {
+        return -1;
+    }
+    for (size_t i = 0; i < corpus->count; i++) {
+        gen(corpus->version[i], sizeof(corpus->version[i]), &seed);
+    }
+    return 0;
+}
+
+static size_t bench_version_sum(const struct bench_corpus *corpus, size_t iterations) {
+    size_t ops = 0;
+    for (size_t n = 0; n < iterations; n++) {
+        for (size_t i = 0; i < corpus->count; i++, ops++) {
+            bench_sink += version_sum(corpus->version[i]);
+        }
+    }
+    return ops;
+}
+
+static size_t bench_version_parse(const struct bench_corpus *corpus, size_t iterations) {
+    size_t ops = 0;
+    vcmp_version version;
+    for (size_t n = 0; n < iterations; n++) {
+        for (size_t i = 0; i < corpus->count; i++, ops++) {
+            bench_sink += version_parse(corpus->version[i], &version);
+        }
+    }
+    return ops;
+}
+
+static size_t bench_version_compare(const struct bench_corpus *corpus, size_t iterations) {
+    size_t ops = 0;
+    for (size_t n = 0; n < iterations; n++) {
+        for (size_t i = 1; i < corpus->count; i++, ops++) {
+            bench_sink += version_compare(GT | EQ, corpus->version[i - 1], corpus->version[i]);
+        }
+    }
+    return ops;
+}
+
+static size_t bench_version_compare_parsed(const struct bench_corpus *corpus, size_t iterations) {
+    size_t ops = 0;
+    vcmp_version *version;
+
+    version = malloc(corpus->count * sizeof(*version));
+    if (!version) {
+        return 0;
+    }
+    for (size_t i = 0; i < corpus->count; i++) {
+        version_parse(corpus->version[i], &version[i]);
+    }
+    for (size_t n = 0; n < iterations; n++) {
+        for (size_t i = 1; i < corpus->count; i++, ops++) {
+            bench_sink += version_compare_parsed(GT | EQ, &version[i - 1], &version[i]);
+        }
+    }
+    free(version);
+    return ops;
+}
+
+static size_t bench_version_index_scan(const struct bench_corpus *corpus, size_t iterations) {
+    size_t ops = 0;
+    const char **versions;
+    vcmp_version version;
+    vcmp_index index;
+    uint64_t *mask;
+
+    versions = malloc(corpus->count * sizeof(*versions));
+    mask = malloc((corpus->count + 63) / 64 * sizeof(*mask));
+    if (!versions || !mask) {
+        free(versions);
+        free(mask);
+        return 0;
+    }
+    for (size_t i = 0; i < corpus->count; i++) {
+        versions[i] = corpus->version[i];
+    }
+    if (version_index_init(&index, versions, corpus->count) < 0) {
+        free(versions);
+        free(mask);
+        return 0;
+    }
+    for (size_t n = 0; n < iterations; n++) {
+        version_index_get(&index, n % index.count, &version);
+        bench_sink += version_index_scan(&index, GT | EQ, &version, mask);
+        ops += index.count;
+    }
+    version_index_close(&index);
+    free(versions);
+    free(mask);
+    return ops;
+}
+
+static size_t bench_version_sort(const struct bench_corpus *corpus, size_t iterations) {
+    size_t ops = 0;
+    const char **versions;
+    vcmp_context ctx;
+
+    versions = malloc(corpus->count * sizeof(*versions));
+    if (!versions || version_context_init(&ctx, corpus->count * 64) < 0) {
+        free(versions);
+        return 0;
+    }
+    for (size_t n = 0; n < iterations; n++) {
+        // Restore the generated order, sorting a sorted array is not the case of interest
+        for (size_t i = 0; i < corpus->count; i++) {
+            versions[i] = corpus->version[i];
+        }
+        bench_sink += version_sort_ctx(&ctx, versions, corpus->count);
+        ops += corpus->count;
+    }
+    version_context_free(&ctx);
+    free(versions);
+    return ops;
+}
+
+static size_t bench_version_parse_operator(const struct bench_corpus *corpus, size_t iterations) {
+    char operators[][4] = {">", ">=", "<", "<=", "=", "!="};
+    size_t ops = 0;
+    for (size_t n = 0; n < iterations; n++) {
+        for (size_t i = 0; i < corpus->count; i++, ops++) {
+            bench_sink += version_parse_operator(operators[i % 6]);
+        }
+    }
+    return ops;
+}
+
+static size_t bench_collapse_whitespace(const struct bench_corpus *corpus, size_t iterations) {
+    char buf[256];
+    size_t ops = 0;
+    for (size_t n = 0; n < iterations; n++) {
+        for (size_t i = 1; i < corpus->count; i++, ops++) {
+            char *s = buf;
+            snprintf(buf, sizeof(buf), "   %s    >=   %s   ", corpus->version[i - 1], corpus->version[i]);
+            bench_sink += (long) strlen(vcmp_collapse_whitespace(&s));
+        }
+    }
+    return ops;
+}
+
+static size_t bench_entry(const struct bench_corpus *corpus, size_t iterations) {
+    char buf[256];
+    char prog[] = "version_compare";
+    size_t ops = 0;
+    int devnull, save_stdout;
+
+    devnull = open("/dev/null", O_WRONLY);
+    save_stdout = dup(fileno(stdout));
+    if (devnull < 0 || save_stdout < 0) {
+        return 0;
+    }
+    fflush(stdout);
+    dup2(devnull, fileno(stdout));
+
+    for (size_t n = 0; n < iterations; n++) {
+        for (size_t i = 1; i < corpus->count; i++, ops++) {
+            char *argv[] = {prog, buf, NULL};
+            snprintf(buf, sizeof(buf), "%s >= %s", corpus->version[i - 1], corpus->version[i]);
+            bench_sink += vcmp_entry(2, argv);
+        }
+    }
+
+    fflush(stdout);
+    dup2(save_stdout, fileno(stdout));
+    close(save_stdout);
+    close(devnull);
+    return ops;
+}
+
+static void bench_run(struct bench_result *result, const char *name, bench_fn fn,
+                      const struct bench_corpus *corpus, size_t iterations) {
+    double start;
+    size_t allocs = 0;
+
+    // Warm up caches and the branch predictor
+    fn(corpus, 1);
+
+#if defined(HAVE_MALLOC_COUNT)
+    malloc_count = 0;
+#endif
+    start = bench_now();
+    result->ops = fn(corpus, iterations);
+    result->ns = bench_now() - start;
+#if defined(HAVE_MALLOC_COUNT)
+    allocs = malloc_count;
+#endif
+    result->name = name;
+    result->corpus = corpus->name;
+    result->allocs = allocs;
+}
+
+static void usage(const char *prog) {
+    printf("usage: %s [--json] [--iterations N]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    struct {
+        const char *name;
+        bench_fn fn;
+    } benches[] = {
+        {"version_sum", bench_version_sum},
+        {"version_parse", bench_version_parse},
+        {"version_compare", bench_version_compare},
+        {"version_compare_parsed", bench_version_compare_parsed},
+        {"version_index_scan", bench_version_index_scan},
+        {"version_sort", bench_version_sort},
+        {"version_parse_operator", bench_version_parse_operator},
+        {"collapse_whitespace", bench_collapse_whitespace},
+        {"entry", bench_entry},
+    };
+    struct {
+        const char *name;
+        void (*gen)(char *, size_t, unsigned *);
+    } corpora[] = {
+        {"semver", corpus_semver},
+        {"rpm", corpus_rpm},
+        {"pep440", corpus_pep440},
+        {"long", corpus_long},
+    };
+    size_t nbenches = sizeof(benches) / sizeof(benches[0]);
+    size_t ncorpora = sizeof(corpora) / sizeof(corpora[0]);
+    struct bench_result *results;
+    size_t iterations = 200;
+    size_t nresults = 0;
+    int json = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--json")) {
+            json = 1;
+        } else if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+            iterations = strtoul(argv[++i], NULL, 10);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!iterations) {
+        iterations = 1;
+    }
+
+    results = calloc(nbenches * ncorpora, sizeof(*results));
+    if (!results) {
+        perror("unable to allocate results");
+        return 1;
+    }
+
+    for (size_t c = 0; c < ncorpora; c++) {
+        struct bench_corpus corpus;
+
+        if (corpus_init(&corpus, corpora[c].name, corpora[c].gen) < 0) {
+            perror("unable to allocate corpus");
+            return 1;
+        }
+        for (size_t b = 0; b < nbenches; b++) {
+            // The CLI path is much slower, keep its run time comparable
+            size_t n = benches[b].fn == bench_entry ? (iterations + 9) / 10 : iterations;
+            bench_run(&results[nresults++], benches[b].name, benches[b].fn, &corpus, n);
+        }
+        free(corpus.version);
+    }
+
+    if (json) {
+        printf("{\n  \"allocations_counted\": %s,\n  \"results\": [\n",
+#if defined(HAVE_MALLOC_COUNT)
+               "true"
+#else
+               "false"
+#endif
+        );
+    } else {
+        printf("%-24s %-8s %12s %16s %14s\n", "benchmark", "corpus", "ns/op", "ops/sec", "allocs/op");
+    }
+    for (size_t i = 0; i < nresults; i++) {
+        struct bench_result *r = &results[i];
+        double ns_op = r->ops ? r->ns / (double) r->ops : 0;
+        double ops_sec = r->ns > 0 ? (double) r->ops * 1e9 / r->ns : 0;
+        double allocs_op = r->ops ? (double) r->allocs / (double) r->ops : 0;
+
+        if (json) {
+            printf("    {\"benchmark\": \"%s\", \"corpus\": \"%s\", \"ops\": %zu, "
+                   "\"ns_per_op\": %.3f, \"ops_per_sec\": %.0f, \"allocs_per_op\": %.3f}%s\n",
+                   r->name, r->corpus, r->ops, ns_op, ops_sec, allocs_op, i + 1 < nresults ? "," : "");
+        } else {
+            printf("%-24s %-8s %12.2f %16.0f %14.3f\n", r->name, r->corpus, ns_op, ops_sec, allocs_op);
+        }
+    }
+    if (json) {
+        printf("  ]\n}\n");
+    }
+
+    free(results);
+    return 0;
+}
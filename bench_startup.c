@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "version_compare.h"
+
+// Measures exec-to-exit time of the command line interface. The benchmark
+// spawns itself in one of the modes below, so every path runs from the same
+// binary, and then spawns the real version_compare.
+
+#define BENCH_EXPR "1.2.3 >= 1.2.3"
+
+extern char **environ;
+
+struct bench_result {
+    const char *name;
+    size_t execs;
+    double mean_ns;
+    double median_ns;
+};
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+static int bench_double_cmp(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * The single-string path as it was before spans: a copy of the argument, a
+ * copy of every token, printf() and exit()
+ */
+static int legacy_entry(char *expr) {
+    char *tokens[4] = {NULL, NULL, NULL, NULL};
+    char *arg, *arg_orig, *token;
+    int ntokens, op, result;
+
+    arg = strdup(expr);
+    if (!arg) {
+        return -1;
+    }
+    arg_orig = arg;
+    vcmp_collapse_whitespace(&arg);
+    for (ntokens = 0; (token = strsep(&arg, " ")) != NULL; ntokens++) {
+        if (ntokens < 4) {
+            tokens[ntokens] = strdup(token);
+        }
+    }
+
+    result = -1;
+    if (ntokens >= 3 && (op = version_parse_operator(tokens[1])) >= 0) {
+        printf("%d\n", version_compare(op, tokens[0], tokens[2]));
+        result = 0;
+    }
+    for (int i = 0; i < ntokens && i < 4; i++) {
+        free(tokens[i]);
+    }
+    free(arg_orig);
+    return result;
+}
+
+/**
+ * Spawn a command repeatedly and time each run until it is reaped
+ * @param result destination
+ * @param name benchmark name
+ * @param argv command
+ * @param execs number of runs
+ * @return 0 on success
+ * @return -1 if the command could not be run or failed
+ */
+static int bench_spawn(struct bench_result *result, const char *name, char *const argv[], size_t execs) {
+    posix_spawn_file_actions_t actions;
+    double *elapsed, total;
+
+    elapsed = malloc(execs * sizeof(*elapsed));
+    if (!elapsed) {
+        return -1;
+    }
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+    // The first run warms the page cache and is not timed
+    total = 0;
+    for (size_t i = 0; i <= execs; i++) {
+        double start = bench_now();
+        pid_t pid;
+        int status;
+
+        if (posix_spawn(&pid, argv[0], &actions, NULL, argv, environ) != 0
+            || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+            fprintf(stderr, "unable to run '%s'\n", argv[0]);
+            posix_spawn_file_actions_destroy(&actions);
+            free(elapsed);
+            return -1;
+        }
+        if (i) {
+            elapsed[i - 1] = bench_now() - start;
+            total += elapsed[i - 1];
+        }
+    }
+    posix_spawn_file_actions_destroy(&actions);
+
+    qsort(elapsed, execs, sizeof(*elapsed), bench_double_cmp);
+    result->name = name;
+    result->execs = execs;
+    result->mean_ns = total / (double) execs;
+    result->median_ns = elapsed[execs / 2];
+    free(elapsed);
+    return 0;
+}
+
+static void usage(const char *prog) {
+    printf("usage: %s [--json] [--iterations N] [path/to/version_compare]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    struct bench_result results[4];
+    char self[4096], sibling[4096], *dir;
+    const char *target = NULL;
+    size_t execs = 1000;
+    size_t nresults = 0;
+    ssize_t len;
+    int json = 0;
+
+    // Modes run by the benchmark itself
+    if (argc == 2 && !strcmp(argv[1], "--noop")) {
+        _exit(0);
+    }
+    if (argc == 3 && !strcmp(argv[1], "--legacy")) {
+        exit(legacy_entry(argv[2]) < 0);
+    }
+    if (argc == 3 && !strcmp(argv[1], "--entry")) {
+        int result = vcmp_entry(2, &argv[1]);
+
+        fflush(stdout);
+        _exit(result);
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--json")) {
+            json = 1;
+        } else if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+            execs = strtoul(argv[++i], NULL, 10);
+        } else if (argv[i][0] != '-' && !target) {
+            target = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!execs) {
+        execs = 1;
+    }
+
+    len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (len < 0) {
+        snprintf(self, sizeof(self), "%s", argv[0]);
+    } else {
+        self[len] = '\0';
+    }
+    // version_compare is built next to this benchmark
+    if (!target) {
+        dir = strrchr(self, '/');
+        snprintf(sibling, sizeof(sibling), "%.*s/version_compare", dir ? (int) (dir - self) : 1, dir ? self : ".");
+        target = sibling;
+    }
+
+    {
+        char *noop[] = {self, "--noop", NULL};
+        char *legacy[] = {self, "--legacy", BENCH_EXPR, NULL};
+        char *spans[] = {self, "--entry", BENCH_EXPR, NULL};
+        char *binary[] = {(char *) target, BENCH_EXPR, NULL};
+
+        if (bench_spawn(&results[nresults++], "spawn (no work)", noop, execs) < 0
+            || bench_spawn(&results[nresults++], "legacy strdup/printf", legacy, execs) < 0
+            || bench_spawn(&results[nresults++], "vcmp_entry() spans/write", spans, execs) < 0
+            || bench_spawn(&results[nresults++], "version_compare", binary, execs) < 0) {
+            return 1;
+        }
+    }
+
+    if (json) {
+        printf("{\n  \"expression\": \"%s\",\n  \"results\": [\n", BENCH_EXPR);
+    } else {
+        printf("%-24s %8s %14s %14s %14s\n", "path", "execs", "mean us", "median us", "execs/sec");
+    }
+    for (size_t i = 0; i < nresults; i++) {
+        struct bench_result *r = &results[i];
+        double execs_sec = r->mean_ns > 0 ? 1e9 / r->mean_ns : 0;
+
+        if (json) {
+            printf("    {\"path\": \"%s\", \"execs\": %zu, \"mean_us\": %.2f, \"median_us\": %.2f, "
+                   "\"execs_per_sec\": %.0f}%s\n",
+                   r->name, r->execs, r->mean_ns / 1e3, r->median_ns / 1e3, execs_sec,
+                   i + 1 < nresults ? "," : "");
+        } else {
+            printf("%-24s %8zu %14.2f %14.2f %14.0f\n",
+                   r->name, r->execs, r->mean_ns / 1e3, r->median_ns / 1e3, execs_sec);
+        }
+    }
+    if (json) {
+        printf("  ]\n}\n");
+    }
+    return 0;
+}
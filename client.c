@@ -0,0 +1,298 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "version_compare.h"
+
+#define CLIENT_SOCKET_DEFAULT "/tmp/version_compare.sock"
+// Requests sent before waiting for their replies
+#define CLIENT_BATCH_MAX 32768
+
+/**
+ * Connect to a "version_compare --serve" socket
+ * @param path socket path
+ * @return connected descriptor
+ * @return -1 on error
+ */
+static int client_connect(const char *path) {
+    struct sockaddr_un addr;
+    int fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Write a whole buffer
+ * @return 0 on success
+ * @return -1 on error
+ */
+static int client_write(int fd, const char *buf, size_t len) {
+    while (len) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            return -1;
+        }
+        buf += n;
+        len -= (size_t) n;
+    }
+    return 0;
+}
+
+struct client_reader {
+    int fd;
+    size_t start;
+    size_t end;
+    char data[4096];
+};
+
+/**
+ * Evaluate a request locally, the way "version_compare --stdin" does
+ *
+ * The server answers -1 for malformed requests without saying why, and
+ * rejects some that --stdin accepts (trailing tokens, overlong lines).
+ *
+ * @param line request (need not be NUL-terminated)
+ * @param len length of line, without the newline
+ * @param invalid incremented if the request is malformed
+ * @return version_compare() result
+ */
+static int client_eval(const char *line, size_t len, size_t *invalid) {
+    const char *ptr, *token[3];
+    size_t rem, token_len[3];
+    int ntokens, op;
+
+    if (len && line[len - 1] == '\r') {
+        len--;
+    }
+    ptr = line;
+    rem = len;
+    for (ntokens = 0; ntokens < 3; ntokens++) {
+        token[ntokens] = vcmp_token_next_n(&ptr, &rem, &token_len[ntokens]);
+        if (!token[ntokens]) {
+            break;
+        }
+    }
+    if (ntokens < 3) {
+        fprintf(stderr, "Invalid version spec (missing whitespace or token?): '%.*s'\n", (int) len, line);
+        (*invalid)++;
+        return -1;
+    }
+    if ((op = version_parse_operator_n(token[1], token_len[1])) < 0) {
+        fprintf(stderr, "Invalid operator sequence: '%.*s'\n", (int) token_len[1], token[1]);
+        (*invalid)++;
+        return -1;
+    }
+    return version_compare_n(op, token[0], token_len[0], token[2], token_len[2]);
+}
+
+/**
+ * Read reply lines from the server
+ *
+ * Replies are read in blocks, bytes past the last reply are kept in the
+ * reader for the next call.
+ *
+ * @param rd reader
+ * @param count number of replies to read
+ * @param requests newline-terminated requests the replies answer, or NULL.
+ * Requests answered with -1 are evaluated locally
+ * @param last destination for the value of the last reply
+ * @param echo non-zero to write the replies to stdout
+ * @param invalid incremented for each malformed request
+ * @return 0 on success
+ * @return -1 if the server went away
+ */
+static int client_read(struct client_reader *rd, size_t count, const char *requests, int *last, int echo,
+                       size_t *invalid) {
+    while (count) {
+        const char *reply, *nl;
+        size_t len;
+
+        nl = memchr(rd->data + rd->start, '\n', rd->end - rd->start);
+        if (!nl) {
+            ssize_t n;
+
+            memmove(rd->data, rd->data + rd->start, rd->end - rd->start);
+            rd->end -= rd->start;
+            rd->start = 0;
+            if (rd->end == sizeof(rd->data)) {
+                return -1;
+            }
+            n = read(rd->fd, rd->data + rd->end, sizeof(rd->data) - rd->end);
+            if (n <= 0) {
+                return -1;
+            }
+            rd->end += (size_t) n;
+            continue;
+        }
+
+        reply = rd->data + rd->start;
+        len = (size_t) (nl - reply) + 1;
+        rd->start += len;
+        count--;
+
+        *last = (int) strtol(reply, NULL, 10);
+        if (requests) {
+            const char *eol = strchr(requests, '\n');
+
+            if (*last < 0) {
+                *last = client_eval(requests, (size_t) (eol - requests), invalid);
+            }
+            requests = eol + 1;
+        }
+        if (echo) {
+            printf("%d\n", *last);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Forward stdin to the server in batches of pipelined requests
+ * @param fd connected descriptor
+ * @param lost set to non-zero if the server went away
+ * @return 0 if every request was valid
+ * @return -1 if any request was invalid or the server went away
+ */
+static int client_stream(int fd, int *lost) {
+    struct client_reader rd;
+    // One extra byte NUL-terminates the batch
+    char batch[CLIENT_BATCH_MAX + 1];
+    char *line;
+    size_t size, used, count, need, content, invalid;
+    ssize_t len;
+    int last;
+
+    rd.fd = fd;
+    rd.start = 0;
+    rd.end = 0;
+    line = NULL;
+    size = 0;
+    used = 0;
+    count = 0;
+    invalid = 0;
+    *lost = 0;
+    while (1) {
+        len = getline(&line, &size, stdin);
+        need = len < 0 ? 0 : (size_t) len + (line[len - 1] != '\n');
+
+        // Flush before the batch overflows, and at the end of input
+        if (used && (len < 0 || used + need > CLIENT_BATCH_MAX)) {
+            batch[used] = '\0';
+            if (client_write(fd, batch, used) < 0 || client_read(&rd, count, batch, &last, 1, &invalid) < 0) {
+                *lost = 1;
+                break;
+            }
+            used = 0;
+            count = 0;
+        }
+        if (len < 0) {
+            break;
+        }
+        // Blank lines get no reply from the server and no output from
+        // --stdin, skip them the same way
+        content = (size_t) len;
+        if (content && line[content - 1] == '\n') {
+            content--;
+        }
+        if (content && line[content - 1] == '\r') {
+            content--;
+        }
+        if (vcmp_isempty_n(line, content)) {
+            continue;
+        }
+
+        if (need > CLIENT_BATCH_MAX) {
+            // Too long for the server, it answers -1 and the line is
+            // evaluated locally
+            if (client_write(fd, line, (size_t) len) < 0 || client_write(fd, "\n", need - (size_t) len) < 0
+                || client_read(&rd, 1, NULL, &last, 0, &invalid) < 0) {
+                *lost = 1;
+                break;
+            }
+            printf("%d\n", client_eval(line, content, &invalid));
+            continue;
+        }
+        memcpy(batch + used, line, (size_t) len);
+        used += (size_t) len;
+        if (need > (size_t) len) {
+            batch[used++] = '\n';
+        }
+        count++;
+    }
+    free(line);
+    return *lost || invalid ? -1 : 0;
+}
+
+/**
+ * Drop-in replacement for version_compare that asks a running
+ * "version_compare --serve" instead of starting up the library.
+ *
+ * The socket is taken from VERSION_COMPARE_SOCKET. Modes the server does not
+ * handle, requests it rejects, and an unreachable server fall back to
+ * evaluating locally, so the output always matches version_compare.
+ */
+int main(int argc, char *argv[]) {
+    struct client_reader rd;
+    const char *path;
+    char request[4096];
+    size_t invalid;
+    int fd, len, lost, result;
+
+    path = getenv("VERSION_COMPARE_SOCKET");
+    if (!path || !*path) {
+        path = CLIENT_SOCKET_DEFAULT;
+    }
+
+    len = -1;
+    if (argc == 2 && strcmp(argv[1], "-") && strcmp(argv[1], "--stdin") && strncmp(argv[1], "--", 2)) {
+        len = snprintf(request, sizeof(request), "%s\n", argv[1]);
+    } else if (argc == 4 && strncmp(argv[1], "--", 2)) {
+        len = snprintf(request, sizeof(request), "%s %s %s\n", argv[1], argv[2], argv[3]);
+    } else if (argc == 2 && (!strcmp(argv[1], "-") || !strcmp(argv[1], "--stdin"))) {
+        len = 0;
+    }
+    if (len < 0 || (size_t) len >= sizeof(request) || (fd = client_connect(path)) < 0) {
+        return vcmp_entry(argc, argv);
+    }
+
+    if (!len) {
+        result = client_stream(fd, &lost);
+        close(fd);
+        if (lost) {
+            fprintf(stderr, "Lost connection to %s\n", path);
+        }
+        return result;
+    }
+
+    rd.fd = fd;
+    rd.start = 0;
+    rd.end = 0;
+    result = -1;
+    invalid = 0;
+    if (client_write(fd, request, (size_t) len) < 0 || client_read(&rd, 1, NULL, &result, 0, &invalid) < 0
+        || result < 0) {
+        // Let the library produce the same output and diagnostics
+        close(fd);
+        return vcmp_entry(argc, argv);
+    }
+    close(fd);
+    printf("%d\n", result);
+    return 0;
+}
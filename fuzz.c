@@ -0,0 +1,480 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "version_compare.h"
+
+// Fuzz targets for libFuzzer and AFL
+//
+// One target is run per binary, selected with -DVCMP_FUZZ_TARGET. Built
+// with -DVCMP_FUZZ_LIBFUZZER (and -fsanitize=fuzzer) the libFuzzer driver is
+// used. Otherwise a standalone driver runs each file argument, or stdin, once
+// (AFL's "@@" and stdin modes), or generates random inputs with --random N.
+
+#if !defined(VCMP_FUZZ_TARGET)
+#define VCMP_FUZZ_TARGET fuzz_differential
+#endif
+
+/**
+ * Report a failed check with the input that caused it, then crash so the
+ * fuzzer keeps the input
+ */
+#define FUZZ_CHECK(cond, data, size) \
+    do { \
+        if (!(cond)) { \
+            fuzz_fail(#cond, __LINE__, data, size); \
+        } \
+    } while (0)
+
+static void fuzz_fail(const char *what, int line, const uint8_t *data, size_t size) {
+    fprintf(stderr, "fuzz.c:%d: check failed: %s\ninput (%zu bytes):", line, what, size);
+    for (size_t i = 0; i < size; i++) {
+        fprintf(stderr, " %02x", data[i]);
+    }
+    fprintf(stderr, "\n");
+    abort();
+}
+
+/**
+ * Copy fuzz input to an exactly sized heap buffer, so out-of-bounds reads
+ * are caught by ASan
+ * @param data input
+ * @param size length of data
+ * @param terminate non-zero to append a terminator
+ * @return copy, release with free()
+ */
+static char *fuzz_copy(const uint8_t *data, size_t size, int terminate) {
+    char *copy = malloc(size + (terminate != 0) + (!size && !terminate));
+
+    if (!copy) {
+        abort();
+    }
+    memcpy(copy, data, size);
+    if (terminate) {
+        copy[size] = '\0';
+    }
+    return copy;
+}
+
+/**
+ * Split fuzz input into NUL-terminated strings at '\0' and '\n'
+ * @param data input
+ * @param size length of data
+ * @param field destination for up to max strings, release field[0] with free()
+ * @param max capacity of field
+ * @return number of strings
+ */
+static int fuzz_split(const uint8_t *data, size_t size, char **field, int max) {
+    char *copy = fuzz_copy(data, size, 1);
+    int count = 0;
+
+    field[count++] = copy;
+    for (size_t i = 0; i < size && count < max; i++) {
+        if (copy[i] == '\0' || copy[i] == '\n') {
+            copy[i] = '\0';
+            field[count++] = copy + i + 1;
+        }
+    }
+    return count;
+}
+
+/**
+ * Reference version_sum(): the original strtoul()-based implementation,
+ * saturating at INT_MAX instead of overflowing
+ */
+static int reference_version_sum(const char *str) {
+    unsigned long long result;
+    int i, epoch;
+    const char *ptr;
+    char *end;
+
+    for (ptr = str; isblank((unsigned char) *ptr); ptr++);
+    if (!*ptr) {
+        return -1;
+    }
+
+    result = 0;
+    epoch = 0;
+    ptr = str;
+    end = (char *) ptr;
+    i = 0;
+    while (end != NULL) {
+        unsigned long long tmp_result = strtoul(ptr, &end, 10);
+
+        if (tmp_result > INT_MAX) {
+            tmp_result = INT_MAX;
+        }
+
+        if (!i && tmp_result && *end != ':') {
+            result += tmp_result * EPOCH_MOD;
+            i++;
+        }
+
+        ptr = end;
+        if (*ptr == '.' || *ptr == '-') {
+            ptr++;
+        } else if (!epoch && *ptr == ':') {
+            epoch = 1;
+            result += EPOCH_MOD;
+            ptr++;
+        } else if (isalpha((unsigned char) *ptr)) {
+            int letter = *ptr - ('a' - 1);
+            result = letter < 0 && (unsigned long long) -letter > result ? 0 : result + (unsigned long long) letter;
+            ptr++;
+        } else {
+            end = NULL;
+        }
+        result += tmp_result;
+        if (result > INT_MAX) {
+            result = INT_MAX;
+        }
+    }
+    return (int) result;
+}
+
+/**
+ * Reference version_parse_operator(): the original strpbrk() loop
+ */
+static int reference_version_parse_operator(const char *str) {
+    const char *ptr;
+    int result = 0;
+
+    for (ptr = str; isblank((unsigned char) *ptr); ptr++);
+    if (!*ptr) {
+        return -1;
+    }
+    for (ptr = str; (ptr = strpbrk(ptr, "><=!")) != NULL; ptr++) {
+        result |= *ptr == '>' ? GT : *ptr == '<' ? LT : *ptr == '=' ? EQ : NOT;
+    }
+    return result ? result : -1;
+}
+
+/**
+ * Reference whitespace helpers, one character at a time into a new buffer
+ */
+static void reference_lstrip(const char *str, char *dest) {
+    while (isblank((unsigned char) *str)) {
+        str++;
+    }
+    strcpy(dest, str);
+}
+
+static void reference_rstrip(const char *str, char *dest) {
+    size_t len = strlen(str);
+
+    while (len && isblank((unsigned char) str[len - 1])) {
+        len--;
+    }
+    memcpy(dest, str, len);
+    dest[len] = '\0';
+}
+
+static void reference_collapse_whitespace(const char *str, char *dest) {
+    char *tmp = malloc(strlen(str) + 1);
+    size_t pos = 0;
+
+    if (!tmp) {
+        abort();
+    }
+    reference_lstrip(str, tmp);
+    reference_rstrip(tmp, tmp);
+    for (size_t i = 0; tmp[i]; i++) {
+        if (i && isblank((unsigned char) tmp[i]) && isblank((unsigned char) tmp[i - 1])) {
+            continue;
+        }
+        dest[pos++] = tmp[i];
+    }
+    dest[pos] = '\0';
+    free(tmp);
+}
+
+/**
+ * Check for a run of letters longer than a vcmp_version tag can hold
+ * @param str input
+ * @return 1 if str contains one, 0 otherwise
+ */
+static int fuzz_long_tag(const char *str) {
+    size_t run = 0;
+
+    for (; *str; str++) {
+        run = isalpha((unsigned char) *str) ? run + 1 : 0;
+        if (run > VCMP_TAG_MAX) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int fuzz_version_sum(const uint8_t *data, size_t size) {
+    char *str = fuzz_copy(data, size, 1);
+    char *span = fuzz_copy(data, size, 0);
+    int result = version_sum(str);
+
+    FUZZ_CHECK(result == version_sum_n(span, strlen(str)), data, size);
+    free(str);
+    free(span);
+    return 0;
+}
+
+int fuzz_version_parse_operator(const uint8_t *data, size_t size) {
+    char *str = fuzz_copy(data, size, 1);
+    char *span = fuzz_copy(data, size, 0);
+    int result = version_parse_operator(str);
+
+    FUZZ_CHECK(result == -1 || (result > 0 && !(result & ~(GT | LT | EQ | NOT))), data, size);
+    FUZZ_CHECK(result == version_parse_operator_n(span, strlen(str)), data, size);
+    free(str);
+    free(span);
+    return 0;
+}
+
+int fuzz_whitespace(const uint8_t *data, size_t size) {
+    char *str = fuzz_copy(data, size, 1);
+    char *span = fuzz_copy(data, size, 0);
+    char *dest = malloc(size + 1);
+    char *ptr;
+    size_t len;
+
+    if (!dest) {
+        abort();
+    }
+    ptr = str;
+    vcmp_lstrip(&ptr);
+    FUZZ_CHECK(ptr == str, data, size);
+    vcmp_rstrip(&ptr);
+    vcmp_collapse_whitespace(&ptr);
+    vcmp_isempty(ptr);
+
+    len = strlen(str);
+    memcpy(str, data, len);
+    vcmp_collapse_whitespace_n(span, len, dest);
+    vcmp_rstrip_n(span, len);
+    vcmp_lstrip_n(span, &len);
+    vcmp_isempty_n(span, size);
+
+    free(str);
+    free(span);
+    free(dest);
+    return 0;
+}
+
+int fuzz_entry(const uint8_t *data, size_t size) {
+    char *argv[7];
+    char *field[5];
+    int count;
+
+    count = fuzz_split(data, size, field, 5);
+    argv[0] = "version_compare";
+    for (int i = 0; i < count; i++) {
+        // Modes that block, or touch files or stdin, are not fuzzed
+        if ((!strncmp(field[i], "--", 2) && strcmp(field[i], "--scheme") && strcmp(field[i], "--stats"))
+            || !strcmp(field[i], "-")) {
+            free(field[0]);
+            return 0;
+        }
+        argv[i + 1] = field[i];
+    }
+    argv[count + 1] = NULL;
+
+    vcmp_entry(count + 1, argv);
+    fflush(stdout);
+    free(field[0]);
+    return 0;
+}
+
+int fuzz_differential(const uint8_t *data, size_t size) {
+    const int isas[] = {VCMP_ISA_SSE2, VCMP_ISA_AVX2};
+    const int schemes[] = {VCMP_SCHEME_SEMVER, VCMP_SCHEME_PEP440, VCMP_SCHEME_DEBIAN, VCMP_SCHEME_RPM};
+    char *field[2];
+    char *a, *b, *expect, *got;
+    vcmp_version parsed_a, parsed_b, isa_a;
+    int count, result, parsed;
+
+    count = fuzz_split(data, size, field, 2);
+    a = field[0];
+    b = count > 1 ? field[1] : "";
+    expect = malloc(strlen(a) + 1);
+    got = malloc(strlen(a) + 1);
+    if (!expect || !got) {
+        abort();
+    }
+
+    // Whitespace helpers against the reference implementations
+    reference_lstrip(a, expect);
+    strcpy(got, a);
+    FUZZ_CHECK(!strcmp(vcmp_lstrip(&got), expect), data, size);
+    reference_rstrip(a, expect);
+    strcpy(got, a);
+    FUZZ_CHECK(!strcmp(vcmp_rstrip(&got), expect), data, size);
+    reference_collapse_whitespace(a, expect);
+    strcpy(got, a);
+    FUZZ_CHECK(!strcmp(vcmp_collapse_whitespace(&got), expect), data, size);
+    FUZZ_CHECK(vcmp_collapse_whitespace_n(a, strlen(a), got) == strlen(expect) && !strcmp(got, expect), data, size);
+
+    // Tokenizers against the reference implementations
+    FUZZ_CHECK(version_sum(a) == reference_version_sum(a), data, size);
+    strcpy(got, a);
+    FUZZ_CHECK(version_parse_operator(got) == reference_version_parse_operator(a), data, size);
+
+    // SIMD tokenizers against the scalar one
+    version_set_isa(VCMP_ISA_SCALAR);
+    parsed = version_parse(a, &parsed_a);
+    for (size_t i = 0; i < sizeof(isas) / sizeof(isas[0]); i++) {
+        if (version_set_isa(isas[i]) < 0) {
+            continue;
+        }
+        result = version_parse(a, &isa_a);
+        FUZZ_CHECK(result == parsed && (result < 0 || !memcmp(&isa_a, &parsed_a, sizeof(isa_a))), data, size);
+    }
+    version_set_isa(VCMP_ISA_AUTO);
+
+    // Every comparison entry point agrees, and ordering is antisymmetric
+    result = version_cmp(a, b);
+    FUZZ_CHECK(result == version_cmp_n(a, strlen(a), b, strlen(b)), data, size);
+    FUZZ_CHECK(version_cmp(b, a) == (result == VCMP_CMP_ERROR ? result : -result), data, size);
+    if (!parsed && !version_parse(b, &parsed_b)) {
+        FUZZ_CHECK(result == version_cmp_parsed(&parsed_a, &parsed_b), data, size);
+    } else {
+        // Only the string functions compare tags longer than VCMP_TAG_MAX
+        FUZZ_CHECK(result == VCMP_CMP_ERROR || fuzz_long_tag(a) || fuzz_long_tag(b), data, size);
+    }
+    for (size_t i = 0; i < sizeof(schemes) / sizeof(schemes[0]); i++) {
+        result = version_cmp_scheme(schemes[i], a, b);
+        FUZZ_CHECK(version_cmp_scheme(schemes[i], b, a) == (result == VCMP_CMP_ERROR ? result : -result), data, size);
+    }
+
+    free(expect);
+    free(got);
+    free(field[0]);
+    return 0;
+}
+
+#if defined(VCMP_FUZZ_LIBFUZZER)
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    return VCMP_FUZZ_TARGET(data, size);
+}
+#else
+/**
+ * Generate a random input that looks enough like a version expression to get
+ * past the first checks
+ * @param buf destination
+ * @param size capacity of buf
+ * @param seed random state
+ * @return length of the input
+ */
+static size_t fuzz_random_input(uint8_t *buf, size_t size, unsigned *seed) {
+    static const char *pieces[] = {
+        "0", "1", "2", "9", "10", "007", "18446744073709551616", "4294967296", "99999999999",
+        ".", ".", "-", ":", "+", "~", "^", "_", "!",
+        "a", "b", "rc", "alpha", "dev", "post", "z", "Z",
+        " ", "\t", "  ", "\n", "\0", "\xff", "\x80",
+        ">", "<", "=", ">=", "<=", "!=", ",", "||",
+        "--scheme", "semver", "pep440", "debian", "rpm", "--stats",
+    };
+    size_t len = 0;
+    size_t count = (size_t) rand_r(seed) % 24;
+
+    for (size_t i = 0; i < count; i++) {
+        const char *piece = pieces[(size_t) rand_r(seed) % (sizeof(pieces) / sizeof(pieces[0]))];
+        size_t piece_len = *piece ? strlen(piece) : 1;
+
+        if (len + piece_len > size) {
+            break;
+        }
+        memcpy(buf + len, piece, piece_len);
+        len += piece_len;
+    }
+    return len;
+}
+
+/**
+ * Read a whole stream
+ * @param fp input
+ * @param size destination for the length
+ * @return contents, release with free()
+ */
+static uint8_t *fuzz_read(FILE *fp, size_t *size) {
+    uint8_t *data = NULL;
+    size_t capacity = 0;
+    size_t n;
+
+    *size = 0;
+    do {
+        if (*size == capacity) {
+            uint8_t *tmp;
+
+            capacity = capacity ? capacity * 2 : 4096;
+            tmp = realloc(data, capacity);
+            if (!tmp) {
+                free(data);
+                return NULL;
+            }
+            data = tmp;
+        }
+        n = fread(data + *size, 1, capacity - *size, fp);
+        *size += n;
+    } while (n);
+    return data;
+}
+
+int main(int argc, char *argv[]) {
+    int devnull;
+
+    // Keep the results of the code under test out of the way. Diagnostics
+    // stay on stderr, next to sanitizer reports
+    devnull = open("/dev/null", O_WRONLY);
+    if (devnull < 0 || dup2(devnull, STDOUT_FILENO) < 0) {
+        perror("unable to redirect stdout");
+        return 1;
+    }
+    close(devnull);
+
+    if (argc == 3 && !strcmp(argv[1], "--random")) {
+        unsigned long n = strtoul(argv[2], NULL, 10);
+        unsigned seed = 1;
+        uint8_t buf[256];
+
+        for (unsigned long i = 0; i < n; i++) {
+            size_t size = fuzz_random_input(buf, sizeof(buf), &seed);
+            VCMP_FUZZ_TARGET(buf, size);
+        }
+        fprintf(stderr, "%lu random inputs passed\n", n);
+        return 0;
+    }
+
+    if (argc < 2) {
+        size_t size;
+        uint8_t *data = fuzz_read(stdin, &size);
+
+        if (!data) {
+            return 1;
+        }
+        VCMP_FUZZ_TARGET(data, size);
+        free(data);
+        return 0;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        FILE *fp = fopen(argv[i], "rb");
+        uint8_t *data;
+        size_t size;
+
+        if (!fp) {
+            fprintf(stderr, "unable to open '%s'\n", argv[i]);
+            return 1;
+        }
+        data = fuzz_read(fp, &size);
+        fclose(fp);
+        if (!data) {
+            return 1;
+        }
+        VCMP_FUZZ_TARGET(data, size);
+        free(data);
+    }
+    return 0;
+}
+#endif
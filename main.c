@@ -1,5 +1,11 @@
+#include <stdio.h>
+#include <unistd.h>
 #include "version_compare.h"
 
 int main(int argc, char *argv[]) {
-    return entry(argc, argv);
+    int result = vcmp_entry(argc, argv);
+
+    // Nothing is registered with atexit(), so only stdout needs flushing
+    fflush(stdout);
+    _exit(result);
 }
@@ -0,0 +1,31 @@
+#include "malloc_count.h"
+
+#if defined(HAVE_MALLOC_COUNT)
+// glibc allows the allocator to be replaced. Forward to the real one while
+// counting how many allocations were made.
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+__thread size_t malloc_count;
+
+void *malloc(size_t size) {
+    malloc_count++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    malloc_count++;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    malloc_count++;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+#endif
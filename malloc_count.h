@@ -0,0 +1,13 @@
+#ifndef VERSION_COMPARE_MALLOC_COUNT_H
+#define VERSION_COMPARE_MALLOC_COUNT_H
+
+#include <stdlib.h>
+
+// Sanitizers replace the allocator themselves
+#if defined(__GLIBC__) && !defined(__SANITIZE_THREAD__) && !defined(__SANITIZE_ADDRESS__)
+#define HAVE_MALLOC_COUNT 1
+// Counts the calling thread's allocations
+extern __thread size_t malloc_count;
+#endif
+
+#endif //VERSION_COMPARE_MALLOC_COUNT_H
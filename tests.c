@@ -1,9 +1,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include "version_compare.h"
+#include "malloc_count.h"
 
 struct TestCase_strings {
     char *s;
@@ -19,6 +26,8 @@ static struct TestCase_strings test_cases_collapse_whitespace[] = {
     {"         leading", "leading"},
     {"         leading and trailing         ", "leading and trailing"},
     {"This  line   will    be     collapsed", "This line will be collapsed"},
+    {"tab \t run", "tab run"},
+    {"\t tab\t\t run \t", "tab\trun"},
 };
 
 static struct TestCase_strings test_cases_lstrip[] = {
@@ -91,11 +100,12 @@ static struct TestCase_version_compare test_cases_version_compare[] = {
     {"2022.1", ">=", "2022.4", 0},
     {"2022.1", "!=", "2022.4", 1},
 
+    // A missing epoch is 0
     {"1:2022.1", "=", "2022.4", 0},
-    {"1:2022.1", "<", "2022.4", 1},
-    {"1:2022.1", "<=", "2022.4", 1},
-    {"1:2022.1", ">", "2022.4", 0},
-    {"1:2022.1", ">=", "2022.4", 0},
+    {"1:2022.1", "<", "2022.4", 0},
+    {"1:2022.1", "<=", "2022.4", 0},
+    {"1:2022.1", ">", "2022.4", 1},
+    {"1:2022.1", ">=", "2022.4", 1},
     {"1:2022.1", "!=", "2022.4", 1},
 
     {"1:2022.1", "=", "2:2022.4", 0},
@@ -125,33 +135,1409 @@ static struct TestCase_version_compare test_cases_version_compare[] = {
     {"2022.4", ">", "2022.1", 1},
     {"2022.4", ">=", "2022.1", 1},
     {"2022.4", "!=", "2022.1", 1},
+
+    {"1.0.150", "=", "2.0.49", 0},
+    {"1.0.150", "<", "2.0.49", 1},
+    {"1.0.150", "<=", "2.0.49", 1},
+    {"1.0.150", ">", "2.0.49", 0},
+    {"1.0.150", ">=", "2.0.49", 0},
+    {"1.0.150", "!=", "2.0.49", 1},
+
+    {"4294967296.1", "=", "4294967295.9", 0},
+    {"4294967296.1", "<", "4294967295.9", 0},
+    {"4294967296.1", "<=", "4294967295.9", 0},
+    {"4294967296.1", ">", "4294967295.9", 1},
+    {"4294967296.1", ">=", "4294967295.9", 1},
+    {"4294967296.1", "!=", "4294967295.9", 1},
+
+    {"1.18446744073709551614", "=", "1.18446744073709551615", 0},
+    {"1.18446744073709551614", "<", "1.18446744073709551615", 1},
+    {"1.18446744073709551614", "<=", "1.18446744073709551615", 1},
+    {"1.18446744073709551614", ">", "1.18446744073709551615", 0},
+    {"1.18446744073709551614", ">=", "1.18446744073709551615", 0},
+    {"1.18446744073709551614", "!=", "1.18446744073709551615", 1},
+};
+
+// VCMP_COMPONENTS_MAX components, and more (rejected as by version_parse()),
+// and tags longer than vcmp_version can hold
+static struct TestCase_version_compare test_cases_version_compare_long[] = {
+    {"1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16", "=", "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16", 1},
+    {"1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16", "<", "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.17", 1},
+    {"1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16", ">", "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15", 1},
+    {"1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17", "=", "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17", -1},
+    {"1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17", "<", "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.18", -1},
+    {"1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17", ">", "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16", -1},
+    {"1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17", "<", "2", -1},
+    {"2", ">", "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17", -1},
+    {"1:1", ">", "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17", -1},
+    {"1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.0", "=", "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16", -1},
+    {"1.0-snapshot", "=", "1.0-snapshots", 0},
+    {"1.0-snapshot", "<", "1.0-snapshots", 1},
+    {"1.0-abcdefghij", "<", "1.0-abcdefghik", 1},
+    {"1.0-abcdefghij", "=", "1.0-abcdefghik", 0},
+    {"1.0-abcdefghij", "=", "1.0-abcdefghij", 1},
+    {"1.0-abcdefghijk", ">", "1.0-abcdefghij", 1},
+    {"1.0-abcdefghij.1", ">", "1.0-abcdefghij", 1},
+    {"1.0-abcdefgh", "<", "1.0-abcdefghij", 1},
+    {"1.0-abcdefgi", ">", "1.0-abcdefghij", 1},
+};
+
+// Not representable as a vcmp_version
+static const char *test_cases_version_parse_long[] = {
+    "1.0-snapshots",
+    "1.0-abcdefghij",
+    "1.0abcdefghi.2",
+};
+
+struct TestCase_version_constraint {
+    char *version, *expr;
+    int result;
+};
+
+static struct TestCase_version_constraint test_cases_version_constraint[] = {
+    {"1.5", ">=1.2, <2.0, !=1.5.3", 1},
+    {"1.5.3", ">=1.2, <2.0, !=1.5.3", 0},
+    {"1.2", ">=1.2, <2.0, !=1.5.3", 1},
+    {"1.1.9", ">=1.2, <2.0, !=1.5.3", 0},
+    {"2.0", ">=1.2, <2.0, !=1.5.3", 0},
+    {"2.0", ">=1.2, <=2.0", 1},
+    {"3.1", ">=1.2, <2.0 || >=3.0", 1},
+    {"2.5", ">=1.2, <2.0 || >=3.0", 0},
+    {"2.5", ">2.5 || <2.5", 0},
+    {"2.5", ">2.5 || =2.5", 1},
+    {"2.5.0", "2.5", 1},
+    {"2.5", "= 2.5", 1},
+    {"2.5", ">3, <1", 0},
+    {"2.5", "<3 || <2 || >1", 1},
+    {"1:0.1", ">=9.9", 1},
+    {"1.0a", ">1.0, <1.0b", 1},
+    {"1.0", "", -1},
+    {"1.0", ">=", -1},
+    {"1.0", ">=1.0,", -1},
+    {"1.0", ">=1.0 <2.0", -1},
+    {"", ">=1.0", -1},
+    {"1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17", ">=1", -1},
+};
+
+struct TestCase_version_cmp {
+    char *a, *b;
+    int result;
+};
+
+static struct TestCase_version_cmp test_cases_version_cmp[] = {
+    {"1", "1", 0},
+    {"1", "1.0.0", 0},
+    {"1.0.0", "1", 0},
+    {"1", "2", -1},
+    {"2", "1", 1},
+    {"1.2", "1.10", -1},
+    {"1.10", "1.2", 1},
+    {"1.0a", "1.0", 1},
+    {"1.0a", "1.0b", -1},
+    {"1.0a", "1.0aa", -1},
+    {"1.0-1", "1.0.1", 0},
+    {"0:1.0", "1.0", 0},
+    {"1:0.1", "9.9", 1},
+    {"", "1", VCMP_CMP_ERROR},
+    {"1", " ", VCMP_CMP_ERROR},
+};
+
+struct TestCase_version_sum {
+    char *str;
+    int result;
+};
+
+static struct TestCase_version_sum test_cases_version_sum[] = {
+    {"1.0.3", 104},
+    {"2.0.0", 202},
+    {"1.0a", 102},
+    {"4000000000.4000000000", INT_MAX},
+    {"21474836.47", INT_MAX},
+    {"99999999999999999999", INT_MAX},
+    {"A", 0},
+    {"", -1},
+};
+
+struct TestCase_version_scheme {
+    int scheme;
+    char *a, *b;
+    int result;
+};
+
+static struct TestCase_version_scheme test_cases_version_scheme[] = {
+    // SemVer 2.0 section 11 precedence chain
+    {VCMP_SCHEME_SEMVER, "1.0.0-alpha", "1.0.0-alpha.1", -1},
+    {VCMP_SCHEME_SEMVER, "1.0.0-alpha.1", "1.0.0-alpha.beta", -1},
+    {VCMP_SCHEME_SEMVER, "1.0.0-alpha.beta", "1.0.0-beta", -1},
+    {VCMP_SCHEME_SEMVER, "1.0.0-beta", "1.0.0-beta.2", -1},
+    {VCMP_SCHEME_SEMVER, "1.0.0-beta.2", "1.0.0-beta.11", -1},
+    {VCMP_SCHEME_SEMVER, "1.0.0-beta.11", "1.0.0-rc.1", -1},
+    {VCMP_SCHEME_SEMVER, "1.0.0-rc.1", "1.0.0", -1},
+    {VCMP_SCHEME_SEMVER, "1.0.0-rc1", "1.0.0-beta", 1},
+    {VCMP_SCHEME_SEMVER, "1.0.0+build5", "1.0.0+build6", 0},
+    {VCMP_SCHEME_SEMVER, "1.0.0-rc.1+build.1", "1.0.0-rc.1", 0},
+    {VCMP_SCHEME_SEMVER, "v2.0.0", "1.99999999999999999999999.0", 1},
+    {VCMP_SCHEME_SEMVER, "1.0", "1.0.0", VCMP_CMP_ERROR},
+    {VCMP_SCHEME_SEMVER, "01.0.0", "1.0.0", VCMP_CMP_ERROR},
+    {VCMP_SCHEME_SEMVER, "1.0.0-01", "1.0.0", VCMP_CMP_ERROR},
+    {VCMP_SCHEME_SEMVER, "1.0.0-", "1.0.0", VCMP_CMP_ERROR},
+    {VCMP_SCHEME_SEMVER, "1.0.0+", "1.0.0", VCMP_CMP_ERROR},
+    // PEP 440 ordering and normalization
+    {VCMP_SCHEME_PEP440, "1.0.dev456", "1.0a1", -1},
+    {VCMP_SCHEME_PEP440, "1.0a1", "1.0a2.dev456", -1},
+    {VCMP_SCHEME_PEP440, "1.0a2.dev456", "1.0a12.dev456", -1},
+    {VCMP_SCHEME_PEP440, "1.0a12", "1.0b1.dev456", -1},
+    {VCMP_SCHEME_PEP440, "1.0b2.post345.dev456", "1.0b2.post345", -1},
+    {VCMP_SCHEME_PEP440, "1.0rc1.dev456", "1.0rc1", -1},
+    {VCMP_SCHEME_PEP440, "1.0rc1", "1.0", -1},
+    {VCMP_SCHEME_PEP440, "1.0", "1.0+abc.5", -1},
+    {VCMP_SCHEME_PEP440, "1.0+abc.7", "1.0+5", -1},
+    {VCMP_SCHEME_PEP440, "1.0+5", "1.0.post456.dev34", -1},
+    {VCMP_SCHEME_PEP440, "1.0.post456.dev34", "1.0.post456", -1},
+    {VCMP_SCHEME_PEP440, "1!1.0", "2.0", 1},
+    {VCMP_SCHEME_PEP440, "1.0", "1.0.0", 0},
+    {VCMP_SCHEME_PEP440, "v1.0-1", "1.0.post1", 0},
+    {VCMP_SCHEME_PEP440, "1.0-Alpha_1", "1.0a1", 0},
+    {VCMP_SCHEME_PEP440, "1.0c1", "1.0rc1", 0},
+    {VCMP_SCHEME_PEP440, "1.0.rev2", "1.0.post2", 0},
+    {VCMP_SCHEME_PEP440, "1.0b", "1.0b0", 0},
+    {VCMP_SCHEME_PEP440, "1.0.x", "1.0", VCMP_CMP_ERROR},
+    {VCMP_SCHEME_PEP440, "1.0+", "1.0", VCMP_CMP_ERROR},
+    // Debian, as dpkg --compare-versions
+    {VCMP_SCHEME_DEBIAN, "1.0~rc1", "1.0", -1},
+    {VCMP_SCHEME_DEBIAN, "1.0~~", "1.0~~a", -1},
+    {VCMP_SCHEME_DEBIAN, "1.0~", "1.0", -1},
+    {VCMP_SCHEME_DEBIAN, "1.0", "1.0a", -1},
+    {VCMP_SCHEME_DEBIAN, "1.0a", "1.0+", -1},
+    {VCMP_SCHEME_DEBIAN, "1.0-1", "1.0-1ubuntu1", -1},
+    {VCMP_SCHEME_DEBIAN, "1.0", "1.0-0", 0},
+    {VCMP_SCHEME_DEBIAN, "1:0.9", "2.0", 1},
+    {VCMP_SCHEME_DEBIAN, "0:1.0", "1.0", 0},
+    {VCMP_SCHEME_DEBIAN, "2.6.32-5-amd64", "2.6.32-10", 1},
+    {VCMP_SCHEME_DEBIAN, "1.001", "1.1", 0},
+    {VCMP_SCHEME_DEBIAN, "a1.0", "1.0", VCMP_CMP_ERROR},
+    {VCMP_SCHEME_DEBIAN, "x:1.0", "1.0", VCMP_CMP_ERROR},
+    // RPM, as rpmvercmp() and rpm.labelCompare()
+    {VCMP_SCHEME_RPM, "1.0~rc1", "1.0", -1},
+    {VCMP_SCHEME_RPM, "1.0^git1", "1.0", 1},
+    {VCMP_SCHEME_RPM, "1.0^git1", "1.0.1", -1},
+    {VCMP_SCHEME_RPM, "1.0^", "1.0~", 1},
+    {VCMP_SCHEME_RPM, "1.0a", "1.0.1", -1},
+    {VCMP_SCHEME_RPM, "1.0a", "1.0", 1},
+    {VCMP_SCHEME_RPM, "2.0.1a", "2.0.1", 1},
+    {VCMP_SCHEME_RPM, "1.05", "1.5", 0},
+    {VCMP_SCHEME_RPM, "1.0", "1_0", 0},
+    {VCMP_SCHEME_RPM, "FC5", "fc4", -1},
+    {VCMP_SCHEME_RPM, "2:1.0-1.el9", "1:9.0-1", 1},
+    {VCMP_SCHEME_RPM, "1.0-1.el9", "1.0-1.el10", -1},
+    {VCMP_SCHEME_RPM, "1.0", "1.0-1", -1},
+    // The default scheme is version_cmp()
+    {VCMP_SCHEME_DEFAULT, "1.0a", "1.0", 1},
+    {VCMP_SCHEME_DEFAULT, "1:0.1", "9.9", 1},
+    {-1, "1.0", "1.0", VCMP_CMP_ERROR},
+};
+
+static struct TestCase_version_compare error_cases_version_compare[] = {
+        // nonsense++
+        {"", "=", "", -1},
+        {" ", "=", "     ", -1},
+        {"a", "", "a", -1},
+        {"a", "", "b", -1},
+        {"a", "@", "b", -1},
+};
+
+static int run_cases_version_compare(struct TestCase_version_compare tests[], size_t size) {
+    int failed = 0;
+    for (size_t i = 0; i < size; i++) {
+        int result = 0;
+        struct TestCase_version_compare *test = &tests[i];
+        int op = version_parse_operator(test->op);
+        result = version_compare(op, test->a, test->b);
+
+        printf("%s %s %s is %s (%d)", test->a, test->op, test->b, result ? "TRUE" : "FALSE" , result);
+        if (test->result != result) {
+            printf("    [FAILED: got %d, expected %d]\n", result, test->result);
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+    return failed;
+}
+
+static int run_cases_version_compare_parsed(struct TestCase_version_compare tests[], size_t size) {
+    int failed = 0;
+    for (size_t i = 0; i < size; i++) {
+        int result = -1;
+        vcmp_version a, b;
+        struct TestCase_version_compare *test = &tests[i];
+        int op = version_parse_operator(test->op);
+        if (!version_parse(test->a, &a) && !version_parse(test->b, &b)) {
+            result = version_compare_parsed(op, &a, &b);
+        }
+
+        printf("%s %s %s is %s (%d)", test->a, test->op, test->b, result ? "TRUE" : "FALSE" , result);
+        if (test->result != result) {
+            printf("    [FAILED: got %d, expected %d]\n", result, test->result);
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+    return failed;
+}
+
+static int run_cases_version_compare_n(struct TestCase_version_compare tests[], size_t size) {
+    int failed = 0;
+    for (size_t i = 0; i < size; i++) {
+        char buf[BUFSIZ];
+        size_t len_a, len_op, len_b;
+        const char *a, *op, *b;
+        int result, sum_a, sum_b;
+        struct TestCase_version_compare *test = &tests[i];
+
+        // Pack the spans back to back with digits in between. Reading past
+        // the end of any span changes the result.
+        len_a = strlen(test->a);
+        len_op = strlen(test->op);
+        len_b = strlen(test->b);
+        snprintf(buf, sizeof(buf), "%s9%s9%s9", test->a, test->op, test->b);
+        a = buf;
+        op = a + len_a + 1;
+        b = op + len_op + 1;
+
+        result = version_compare_n(version_parse_operator_n(op, len_op), a, len_a, b, len_b);
+        sum_a = version_sum_n(a, len_a);
+        sum_b = version_sum_n(b, len_b);
+
+        printf("%s %s %s is %s (%d)", test->a, test->op, test->b, result ? "TRUE" : "FALSE" , result);
+        if (test->result != result) {
+            printf("    [FAILED: got %d, expected %d]\n", result, test->result);
+            failed++;
+        } else if (sum_a != version_sum(test->a) || sum_b != version_sum(test->b)) {
+            printf("    [FAILED: version_sum_n() got %d and %d, expected %d and %d]\n",
+                   sum_a, sum_b, version_sum(test->a), version_sum(test->b));
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+    return failed;
+}
+
+static int run_cases_version_cache(struct TestCase_version_compare tests[], size_t size) {
+    int failed = 0;
+    const char *filename = "cache.log";
+    vcmp_cache_stats stats;
+
+    // pass 0 fills a small cache, pass 1 runs against what survived
+    // eviction, pass 2 runs against a cache loaded from disk
+    for (int pass = 0; pass < 3; pass++) {
+        if (pass == 0 && version_cache_init(8) < 0) {
+            printf("version_cache_init failed    [FAILED]\n");
+            return 1;
+        }
+        if (pass == 2) {
+            version_cache_init(size * 2);
+            if (version_cache_load(filename) < 0) {
+                printf("version_cache_load failed    [FAILED]\n");
+                failed++;
+            }
+        }
+
+        for (size_t i = 0; i < size; i++) {
+            int result = 0;
+            struct TestCase_version_compare *test = &tests[i];
+            int op = version_parse_operator(test->op);
+            result = version_compare(op, test->a, test->b);
+
+            if (test->result != result) {
+                printf("%s %s %s is %s (%d)", test->a, test->op, test->b, result ? "TRUE" : "FALSE" , result);
+                printf("    [FAILED: pass %d got %d, expected %d]\n", pass, result, test->result);
+                failed++;
+            }
+        }
+
+        version_cache_stats(&stats);
+        printf("pass %d: %zu hits, %zu misses, %zu evictions, %zu/%zu entries", pass,
+               stats.hits, stats.misses, stats.evictions, stats.entries, stats.capacity);
+        if (stats.entries > stats.capacity
+            || (pass == 0 && !stats.evictions)
+            || (pass == 1 && stats.hits + stats.misses != 2 * size)
+            || (pass == 2 && stats.misses)) {
+            printf("    [FAILED]\n");
+            failed++;
+        } else {
+            puts("");
+        }
+
+        // Save everything seen so far for pass 2
+        if (pass == 1) {
+            version_cache_init(size * 2);
+            for (size_t i = 0; i < size; i++) {
+                version_compare(EQ, tests[i].a, tests[i].b);
+            }
+            if (version_cache_save(filename) < 0) {
+                printf("version_cache_save failed    [FAILED]\n");
+                failed++;
+            }
+        }
+    }
+
+    version_cache_free();
+    remove(filename);
+    return failed;
+}
+
+struct TestThread_version {
+    size_t iterations;
+    int failed;
 };
 
-static struct TestCase_version_compare error_cases_version_compare[] = {
-        // nonsense++
-        {"", "=", "", -1},
-        {" ", "=", "     ", -1},
-        {"a", "", "a", -1},
-        {"a", "", "b", -1},
-        {"a", "@", "b", -1},
-};
+static void *run_thread_version(void *arg) {
+    struct TestThread_version *state = arg;
+    const size_t ncompare = sizeof(test_cases_version_compare) / sizeof(test_cases_version_compare[0]);
+    const size_t nconstraint = sizeof(test_cases_version_constraint) / sizeof(test_cases_version_constraint[0]);
+    const char *sorted[] = {"0.9", "1.0.1", "1.0a", "1.0b", "1:0.1"};
+    const char *versions[sizeof(sorted) / sizeof(sorted[0])];
+    vcmp_context ctx;
+
+    if (version_context_init(&ctx, 0) < 0) {
+        state->failed++;
+        return NULL;
+    }
+
+    for (size_t n = 0; n < state->iterations; n++) {
+        for (size_t i = 0; i < ncompare; i++) {
+            struct TestCase_version_compare *test = &test_cases_version_compare[i];
+            int op = version_parse_operator(test->op);
+            if (version_compare(op, test->a, test->b) != test->result
+                || version_compare_n(op, test->a, strlen(test->a), test->b, strlen(test->b)) != test->result) {
+                state->failed++;
+            }
+        }
+        for (size_t i = 0; i < nconstraint; i++) {
+            struct TestCase_version_constraint *test = &test_cases_version_constraint[i];
+            if (version_satisfies_ctx(&ctx, test->version, test->expr) != test->result
+                || version_satisfies(test->version, test->expr) != test->result) {
+                state->failed++;
+            }
+        }
+
+        // Reverse, then sort back
+        for (size_t i = 0; i < sizeof(versions) / sizeof(versions[0]); i++) {
+            versions[i] = sorted[sizeof(sorted) / sizeof(sorted[0]) - 1 - i];
+        }
+        if (version_sort_ctx(&ctx, versions, sizeof(versions) / sizeof(versions[0])) < 0
+            || memcmp(versions, sorted, sizeof(sorted))) {
+            state->failed++;
+        }
+        if (ctx.used) {
+            state->failed++;
+        }
+    }
+
+    version_context_free(&ctx);
+    return NULL;
+}
+
+static int run_cases_version_threads(size_t threads, size_t iterations) {
+    int failed = 0;
+    struct TestThread_version state[16];
+    pthread_t tid[16];
+    vcmp_cache_stats stats;
+
+    if (threads > sizeof(tid) / sizeof(tid[0])) {
+        threads = sizeof(tid) / sizeof(tid[0]);
+    }
+
+    // A small cache so threads contend on it and evict each other's entries
+    version_cache_init(16);
+    for (size_t i = 0; i < threads; i++) {
+        state[i].iterations = iterations;
+        state[i].failed = 0;
+        if (pthread_create(&tid[i], NULL, run_thread_version, &state[i])) {
+            perror("pthread_create");
+            threads = i;
+            failed++;
+            break;
+        }
+    }
+    for (size_t i = 0; i < threads; i++) {
+        pthread_join(tid[i], NULL);
+    }
+    version_cache_stats(&stats);
+    version_cache_free();
+
+    for (size_t i = 0; i < threads; i++) {
+        printf("thread %zu: %zu iterations", i, iterations);
+        if (state[i].failed) {
+            printf("    [FAILED: %d mismatches]\n", state[i].failed);
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+    printf("cache: %zu hits, %zu misses, %zu evictions\n", stats.hits, stats.misses, stats.evictions);
+    return failed;
+}
+
+static int run_cases_version_context_noalloc(struct TestCase_version_constraint tests[], size_t size) {
+    int failed = 0;
+#if defined(HAVE_MALLOC_COUNT)
+    vcmp_context ctx;
+
+    if (version_context_init(&ctx, 0) < 0) {
+        return 1;
+    }
+    for (size_t i = 0; i < size; i++) {
+        size_t count;
+        struct TestCase_version_constraint *test = &tests[i];
+
+        malloc_count = 0;
+        version_satisfies_ctx(&ctx, test->version, test->expr);
+        count = malloc_count;
+
+        printf("'%s' satisfies '%s' made %zu allocation(s)", test->version, test->expr, count);
+        if (count) {
+            printf("    [FAILED: expected 0]\n");
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+    version_context_free(&ctx);
+#else
+    (void) tests;
+    (void) size;
+    puts("SKIPPED: allocation counting is not supported on this platform");
+#endif
+    return failed;
+}
+
+#if defined(VCMP_ENABLE_STATS)
+static void *run_thread_version_stats(void *arg) {
+    (void) arg;
+    version_compare(LT, "1.0", "2.0");
+    return NULL;
+}
+#endif
+
+static int run_cases_version_stats(struct TestCase_version_compare tests[], size_t size) {
+    int failed = 0;
+#if defined(VCMP_ENABLE_STATS)
+    vcmp_stats stats, expect;
+    vcmp_version version;
+    vcmp_constraint constraint;
+    pthread_t tid;
+
+    // String comparisons parse both sides on the way, schemes and
+    // constraints count as comparisons
+    version_stats_reset();
+    version_compare(LT, "1.2.3", "2.0");
+    version_compare_scheme(VCMP_SCHEME_SEMVER, LT, "1.0.0-rc.1", "1.0.0");
+    version_compare(LT, "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17", "1");
+    version_stats_get(&stats);
+    printf("string comparisons: %llu parses (%llu failed, %llu bytes), %llu compares",
+           (unsigned long long) stats.parses, (unsigned long long) stats.parse_failures,
+           (unsigned long long) stats.bytes_scanned, (unsigned long long) stats.compares);
+    if (stats.parses != 6 || stats.parse_failures != 1 || stats.bytes_scanned < 5 + 3 + 15 || stats.compares != 3) {
+        printf("    [FAILED: expected 6 parses (1 failed, at least 23 bytes), 3 compares]\n");
+        failed++;
+    } else {
+        puts("");
+    }
+
+    if (version_constraint_parse(">=1.2, <2.0", &constraint) < 0) {
+        return failed + 1;
+    }
+    version_parse("1.5", &version);
+    version_stats_reset();
+    version_constraint_match(&constraint, &version);
+    version_constraint_free(&constraint);
+    version_stats_get(&stats);
+    printf("version_constraint_match(): %llu compares", (unsigned long long) stats.compares);
+    if (stats.compares != 1) {
+        printf("    [FAILED: expected 1]\n");
+        failed++;
+    } else {
+        puts("");
+    }
+
+    memset(&expect, 0, sizeof(expect));
+    version_stats_reset();
+    for (size_t i = 0; i < size; i++) {
+        struct TestCase_version_compare *test = &tests[i];
+        int op = version_parse_operator(test->op);
+
+        version_compare(op, test->a, test->b);
+        expect.compares++;
+        if (op > 0) {
+            expect.compares_gt += !!(op & GT);
+            expect.compares_lt += !!(op & LT);
+            expect.compares_eq += !!(op & EQ);
+            expect.compares_not += !!(op & NOT);
+        }
+        expect.compare_failures += test->result < 0;
+    }
+    // The walks of the comparisons above are checked separately
+    version_stats_get(&stats);
+    expect.parses = stats.parses;
+    expect.parse_failures = stats.parse_failures;
+    expect.bytes_scanned = stats.bytes_scanned;
+
+    version_parse("1.2.3", &version);
+    version_parse("", &version);
+    version_sum("1.2");
+    expect.parses += 3;
+    expect.parse_failures += 1;
+    expect.bytes_scanned += 5 + 0 + 3;
+
+    // Counters of exited threads are kept
+    pthread_create(&tid, NULL, run_thread_version_stats, NULL);
+    pthread_join(tid, NULL);
+    expect.compares++;
+    expect.compares_lt++;
+    expect.parses += 2;
+    expect.bytes_scanned += 3 + 3;
+
+    version_stats_get(&stats);
+    printf("%llu parses (%llu failed, %llu bytes), %llu compares (GT %llu, LT %llu, EQ %llu, NOT %llu, %llu failed)",
+           (unsigned long long) stats.parses, (unsigned long long) stats.parse_failures,
+           (unsigned long long) stats.bytes_scanned, (unsigned long long) stats.compares,
+           (unsigned long long) stats.compares_gt, (unsigned long long) stats.compares_lt,
+           (unsigned long long) stats.compares_eq, (unsigned long long) stats.compares_not,
+           (unsigned long long) stats.compare_failures);
+    stats.parse_cycles = stats.compare_cycles = 0;
+    if (memcmp(&stats, &expect, sizeof(stats))) {
+        printf("    [FAILED: expected %llu parses (%llu failed, %llu bytes), %llu compares (%llu failed)]\n",
+               (unsigned long long) expect.parses, (unsigned long long) expect.parse_failures,
+               (unsigned long long) expect.bytes_scanned, (unsigned long long) expect.compares,
+               (unsigned long long) expect.compare_failures);
+        failed++;
+    } else {
+        puts("");
+    }
+
+    version_stats_reset();
+    version_stats_get(&stats);
+    if (stats.parses || stats.compares) {
+        printf("version_stats_reset() left counters    [FAILED]\n");
+        failed++;
+    }
+#else
+    (void) tests;
+    (void) size;
+    puts("SKIPPED: statistics are disabled (VCMP_ENABLE_STATS)");
+#endif
+    return failed;
+}
+
+static int run_cases_version_compare_noalloc(struct TestCase_version_compare tests[], size_t size) {
+    int failed = 0;
+#if defined(HAVE_MALLOC_COUNT)
+    for (size_t i = 0; i < size; i++) {
+        size_t count;
+        struct TestCase_version_compare *test = &tests[i];
+        int op = version_parse_operator(test->op);
+
+        malloc_count = 0;
+        version_sum(test->a);
+        version_sum(test->b);
+        version_compare(op, test->a, test->b);
+        count = malloc_count;
+
+        printf("%s %s %s made %zu allocation(s)", test->a, test->op, test->b, count);
+        if (count) {
+            printf("    [FAILED: expected 0]\n");
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+#else
+    (void) tests;
+    (void) size;
+    puts("SKIPPED: allocation counting is not supported on this platform");
+#endif
+    return failed;
+}
+
+static int run_cases_version_sum(struct TestCase_version_sum tests[], size_t size) {
+    int failed = 0;
+    for (size_t i = 0; i < size; i++) {
+        struct TestCase_version_sum *test = &tests[i];
+        int result = version_sum(test->str);
+
+        printf("'%s' sums to %d", test->str, result);
+        if (test->result != result) {
+            printf("    [FAILED: expected %d]\n", test->result);
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+    return failed;
+}
+
+static int run_cases_version_cmp(struct TestCase_version_cmp tests[], size_t size) {
+    int failed = 0;
+    for (size_t i = 0; i < size; i++) {
+        int result = 0;
+        vcmp_version a, b;
+        struct TestCase_version_cmp *test = &tests[i];
+        result = version_cmp(test->a, test->b);
+
+        printf("'%s' <=> '%s' is %d", test->a, test->b, result);
+        if (test->result != result) {
+            printf("    [FAILED: got %d, expected %d]\n", result, test->result);
+            failed++;
+            continue;
+        }
+
+        if (!version_parse(test->a, &a) && !version_parse(test->b, &b)) {
+            result = version_cmp_parsed(&a, &b);
+        } else {
+            result = VCMP_CMP_ERROR;
+        }
+        if (test->result != result) {
+            printf("    [FAILED: parsed got %d, expected %d]\n", result, test->result);
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+    return failed;
+}
+
+static int run_cases_version_parse_long(const char *tests[], size_t size) {
+    int failed = 0;
+    for (size_t i = 0; i < size; i++) {
+        vcmp_version version;
+        int result = version_parse(tests[i], &version);
+
+        printf("'%s' parses to %d", tests[i], result);
+        if (result != -1 || version_parse_scalar(tests[i], &version) != -1) {
+            printf("    [FAILED: expected -1]\n");
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+
+    // Sorting compares the whole tag
+    {
+        const char *versions[] = {"1.0-abcdefghik", "1.0-snapshots", "1.0-abcdefghij", "1.0-snapshot"};
+        const char *expect[] = {"1.0-abcdefghij", "1.0-abcdefghik", "1.0-snapshot", "1.0-snapshots"};
+
+        version_sort_stable(versions, sizeof(versions) / sizeof(versions[0]));
+        for (size_t i = 0; i < sizeof(versions) / sizeof(versions[0]); i++) {
+            if (strcmp(versions[i], expect[i])) {
+                printf("sorted[%zu] is '%s', expected '%s'    [FAILED]\n", i, versions[i], expect[i]);
+                failed++;
+            }
+        }
+    }
+    return failed;
+}
+
+static int run_cases_version_scheme(struct TestCase_version_scheme tests[], size_t size) {
+    int failed = 0;
+    for (size_t i = 0; i < size; i++) {
+        struct TestCase_version_scheme *test = &tests[i];
+        int result = version_cmp_scheme(test->scheme, test->a, test->b);
+        int reverse = version_cmp_scheme(test->scheme, test->b, test->a);
+
+        printf("scheme %d: '%s' <=> '%s' is %d", test->scheme, test->a, test->b, result);
+        if (test->result != result) {
+            printf("    [FAILED: got %d, expected %d]\n", result, test->result);
+            failed++;
+        } else if (reverse != (result == VCMP_CMP_ERROR ? VCMP_CMP_ERROR : -result)) {
+            printf("    [FAILED: reversed got %d]\n", reverse);
+            failed++;
+        } else if (version_compare_scheme(test->scheme, GT | EQ, test->a, test->b)
+                   != (result == VCMP_CMP_ERROR ? -1 : result >= 0)) {
+            printf("    [FAILED: version_compare_scheme() disagrees]\n");
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+    return failed;
+}
+
+static unsigned test_random(unsigned *seed) {
+    *seed = *seed * 1103515245 + 12345;
+    return (*seed >> 16) & 0x7fff;
+}
+
+static void test_random_version(char *buf, size_t size, unsigned *seed) {
+    size_t len = 0;
+    unsigned parts = 1 + test_random(seed) % 5;
+
+    if (!(test_random(seed) % 8)) {
+        len += (size_t) snprintf(buf + len, size - len, "%u:", test_random(seed) % 3);
+    }
+    for (unsigned i = 0; i < parts && len < size; i++) {
+        len += (size_t) snprintf(buf + len, size - len, "%s%u", i ? "." : "", test_random(seed) % 12);
+        if (len < size && !(test_random(seed) % 6)) {
+            len += (size_t) snprintf(buf + len, size - len, "%c", 'a' + test_random(seed) % 4);
+        }
+    }
+}
+
+static int run_cases_version_compare_many(size_t n) {
+    int failed = 0;
+    const int flags[] = {GT, LT, EQ, GT | EQ, LT | EQ, NOT | EQ};
+    const unsigned threads[] = {1, 3, 0};
+    char (*storage)[2][32];
+    const char **a, **b;
+    int *out;
+    unsigned seed = 1;
+
+    storage = calloc(n, sizeof(*storage));
+    a = calloc(n, sizeof(*a));
+    b = calloc(n, sizeof(*b));
+    out = calloc(n, sizeof(*out));
+    if (!storage || !a || !b || !out) {
+        perror("unable to allocate version pairs");
+        return 1;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        test_random_version(storage[i][0], sizeof(storage[i][0]), &seed);
+        test_random_version(storage[i][1], sizeof(storage[i][1]), &seed);
+        a[i] = storage[i][0];
+        b[i] = storage[i][1];
+    }
+    // An invalid pair must produce the same error as the scalar path
+    a[n / 2] = "";
+
+    for (size_t f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+        for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+            size_t mismatch = 0;
+
+            memset(out, 0xff, n * sizeof(*out));
+            if (version_compare_many(flags[f], a, b, out, n, threads[t]) < 0) {
+                printf("flags %d, %u thread(s)    [FAILED: returned error]\n", flags[f], threads[t]);
+                failed++;
+                continue;
+            }
+            for (size_t i = 0; i < n; i++) {
+                if (out[i] != version_compare(flags[f], a[i], b[i])) {
+                    mismatch++;
+                }
+            }
+
+            printf("flags %d, %u thread(s), %zu pairs", flags[f], threads[t], n);
+            if (mismatch) {
+                printf("    [FAILED: %zu result(s) differ from version_compare()]\n", mismatch);
+                failed++;
+            } else {
+                puts("");
+            }
+        }
+    }
+
+    free(storage);
+    free(a);
+    free(b);
+    free(out);
+    return failed;
+}
+
+static int run_cases_version_sort_key(size_t n) {
+    int failed = 0;
+    unsigned seed = 2;
+
+    for (size_t i = 0; i < n; i++) {
+        char str_a[32], str_b[32];
+        unsigned char key_a[VCMP_SORT_KEY_MAX], key_b[VCMP_SORT_KEY_MAX];
+        vcmp_version a, b;
+        int expected, result;
+
+        test_random_version(str_a, sizeof(str_a), &seed);
+        test_random_version(str_b, sizeof(str_b), &seed);
+        version_parse(str_a, &a);
+        version_parse(str_b, &b);
+        version_sort_key(&a, key_a, sizeof(key_a));
+        version_sort_key(&b, key_b, sizeof(key_b));
+
+        expected = version_cmp_parsed(&a, &b);
+        result = memcmp(key_a, key_b, sizeof(key_a));
+        result = (result > 0) - (result < 0);
+        if (result != expected) {
+            printf("key('%s') <=> key('%s') is %d    [FAILED: expected %d]\n", str_a, str_b, result, expected);
+            failed++;
+        }
+    }
+    printf("%zu key pairs ordered like version_cmp_parsed()%s\n", n, failed ? "    [FAILED]" : "");
+    return failed;
+}
+
+static int run_cases_version_sort(size_t n) {
+    int failed = 0;
+    const char *versions[] = {
+        "1.10", "2:0.1", "", "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.17", "1.0", "1.0a",
+        "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16", "1", "0.9", "1.2", "1.0.0", "1:0",
+        "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17",
+    };
+    const char *expected[] = {
+        "0.9", "1.0", "1", "1.0.0", "1.0a", "1.2",
+        "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16", "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.17",
+        "1.10", "1:0", "2:0.1", "", "1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17",
+    };
+    size_t count = sizeof(versions) / sizeof(versions[0]);
+    char (*storage)[32];
+    const char **random;
+    unsigned seed = 3;
+
+    version_sort_stable(versions, count);
+    for (size_t i = 0; i < count; i++) {
+        printf("'%s'", versions[i]);
+        if (strcmp(versions[i], expected[i])) {
+            printf("    [FAILED: expected '%s']\n", expected[i]);
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+
+    storage = calloc(n, sizeof(*storage));
+    random = calloc(n, sizeof(*random));
+    if (!storage || !random) {
+        perror("unable to allocate versions");
+        return failed + 1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        test_random_version(storage[i], sizeof(storage[i]), &seed);
+        random[i] = storage[i];
+    }
+    version_sort(random, n);
+    for (size_t i = 1; i < n; i++) {
+        if (version_cmp(random[i - 1], random[i]) > 0) {
+            printf("'%s' sorted before '%s'    [FAILED]\n", random[i - 1], random[i]);
+            failed++;
+            break;
+        }
+    }
+    printf("%zu random versions sorted%s\n", n, failed ? "    [FAILED]" : "");
+
+    // Equal versions keep their order, pointers into storage increase with it
+    for (size_t i = 0; i < n; i++) {
+        random[i] = storage[i];
+    }
+    version_sort_stable(random, n);
+    for (size_t i = 1; i < n; i++) {
+        int cmp = version_cmp(random[i - 1], random[i]);
+
+        if (cmp > 0 || (cmp == 0 && random[i - 1] > random[i])) {
+            printf("'%s' sorted before '%s'    [FAILED: not stable]\n", random[i - 1], random[i]);
+            failed++;
+            break;
+        }
+    }
+    printf("%zu random versions sorted stably\n", n);
+
+#if defined(HAVE_MALLOC_COUNT)
+    {
+        vcmp_context ctx;
+
+        if (version_context_init(&ctx, n * 64) < 0) {
+            free(storage);
+            free(random);
+            return failed + 1;
+        }
+        for (size_t i = 0; i < n; i++) {
+            random[i] = storage[i];
+        }
+        malloc_count = 0;
+        version_sort_ctx(&ctx, random, n);
+        printf("version_sort_ctx() made %zu allocation(s)", (size_t) malloc_count);
+        if (malloc_count) {
+            printf("    [FAILED: expected 0]\n");
+            failed++;
+        } else {
+            puts("");
+        }
+        version_context_free(&ctx);
+    }
+#endif
+
+    free(storage);
+    free(random);
+    return failed;
+}
+
+static int run_cases_version_constraint(struct TestCase_version_constraint tests[], size_t size) {
+    int failed = 0;
+    for (size_t i = 0; i < size; i++) {
+        int result = 0;
+        struct TestCase_version_constraint *test = &tests[i];
+        result = version_satisfies(test->version, test->expr);
+
+        printf("'%s' satisfies '%s' is %s (%d)", test->version, test->expr, result ? "TRUE" : "FALSE", result);
+        if (test->result != result) {
+            printf("    [FAILED: got %d, expected %d]\n", result, test->result);
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+    return failed;
+}
+
+static int run_cases_version_constraint_random(size_t n) {
+    int failed = 0;
+    const char *operators[] = {">", ">=", "<", "<=", "=", "!="};
+    unsigned seed = 4;
+
+    // Compare the compiled intervals against evaluating each clause
+    for (size_t i = 0; i < n; i++) {
+        char bound[4][32], expr[256], candidate[32];
+        const char *op[4];
+        vcmp_constraint constraint;
+        vcmp_version version;
+        int expected, result;
+
+        for (int c = 0; c < 4; c++) {
+            test_random_version(bound[c], sizeof(bound[c]), &seed);
+            op[c] = operators[test_random(&seed) % 6];
+        }
+        snprintf(expr, sizeof(expr), "%s%s, %s%s || %s%s, %s%s",
+                 op[0], bound[0], op[1], bound[1], op[2], bound[2], op[3], bound[3]);
+        if (version_constraint_parse(expr, &constraint) < 0) {
+            printf("'%s'    [FAILED: could not be parsed]\n", expr);
+            failed++;
+            continue;
+        }
+
+        for (int k = 0; k < 16; k++) {
+            test_random_version(candidate, sizeof(candidate), &seed);
+            version_parse(candidate, &version);
+            expected = (version_compare(version_parse_operator((char *) op[0]), candidate, bound[0])
+                        && version_compare(version_parse_operator((char *) op[1]), candidate, bound[1]))
+                       || (version_compare(version_parse_operator((char *) op[2]), candidate, bound[2])
+                           && version_compare(version_parse_operator((char *) op[3]), candidate, bound[3]));
+            result = version_constraint_match(&constraint, &version);
+            if (result != expected) {
+                printf("'%s' satisfies '%s' is %d    [FAILED: expected %d]\n", candidate, expr, result, expected);
+                failed++;
+            }
+        }
+        version_constraint_free(&constraint);
+    }
+    printf("%zu random constraints matched clause by clause%s\n", n, failed ? "    [FAILED]" : "");
+    return failed;
+}
+
+static int run_cases_version_select(size_t n) {
+    int failed = 0;
+    const char *operators[] = {">", ">=", "<", "<=", "=", "!="};
+    vcmp_version *versions;
+    vcmp_candidates candidates;
+    unsigned seed = 5;
+    size_t queries = 2000;
+
+    versions = calloc(n, sizeof(*versions));
+    if (!versions) {
+        perror("unable to allocate candidates");
+        return 1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        char str[32];
+        test_random_version(str, sizeof(str), &seed);
+        version_parse(str, &versions[i]);
+    }
+    if (version_candidates_init(&candidates, versions, n) < 0) {
+        perror("unable to index candidates");
+        free(versions);
+        return 1;
+    }
+
+    // The linear scan, the sorted index and brute force must agree
+    for (size_t q = 0; q < queries; q++) {
+        char bound[2][32], expr[128];
+        vcmp_constraint constraint;
+        int expected_found[2] = {0, 0};
+        size_t expected[2] = {0, 0};
+
+        test_random_version(bound[0], sizeof(bound[0]), &seed);
+        test_random_version(bound[1], sizeof(bound[1]), &seed);
+        snprintf(expr, sizeof(expr), "%s%s, %s%s",
+                 operators[test_random(&seed) % 6], bound[0], operators[test_random(&seed) % 6], bound[1]);
+        version_constraint_parse(expr, &constraint);
+
+        for (size_t i = 0; i < n; i++) {
+            if (version_constraint_match(&constraint, &versions[i]) != 1) {
+                continue;
+            }
+            if (!expected_found[0] || version_cmp_parsed(&versions[i], &versions[expected[0]]) < 0) {
+                expected[0] = i;
+                expected_found[0] = 1;
+            }
+            if (!expected_found[1] || version_cmp_parsed(&versions[i], &versions[expected[1]]) > 0) {
+                expected[1] = i;
+                expected_found[1] = 1;
+            }
+        }
+
+        for (int highest = 0; highest < 2; highest++) {
+            size_t index[2] = {0, 0};
+            int found[2];
+
+            if (highest) {
+                found[0] = version_select_max(&constraint, versions, n, &index[0]);
+                found[1] = version_candidates_select_max(&candidates, &constraint, &index[1]);
+            } else {
+                found[0] = version_select_min(&constraint, versions, n, &index[0]);
+                found[1] = version_candidates_select_min(&candidates, &constraint, &index[1]);
+            }
+            for (int k = 0; k < 2; k++) {
+                if (found[k] != expected_found[highest] || (found[k] && index[k] != expected[highest])) {
+                    printf("%s '%s' (%s)    [FAILED: got %d/%zu, expected %d/%zu]\n",
+                           highest ? "max" : "min", expr, k ? "sorted" : "linear",
+                           found[k], index[k], expected_found[highest], expected[highest]);
+                    failed++;
+                }
+            }
+        }
+        version_constraint_free(&constraint);
+    }
+    printf("%zu queries over %zu candidates%s\n", queries, n, failed ? "    [FAILED]" : "");
+
+    version_candidates_free(&candidates);
+    free(versions);
+    return failed;
+}
+
+static int run_cases_version_table(size_t n) {
+    int failed = 0;
+    const int flags[] = {GT, LT, EQ, GT | EQ, LT | EQ, NOT | EQ};
+    char (*storage)[32];
+    int *ids;
+    vcmp_table table;
+    unsigned seed = 6;
 
-static int run_cases_version_compare(struct TestCase_version_compare tests[], size_t size) {
+    storage = calloc(n, sizeof(*storage));
+    ids = calloc(n, sizeof(*ids));
+    if (!storage || !ids || version_table_init(&table) < 0) {
+        perror("unable to allocate version table");
+        return 1;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        test_random_version(storage[i], sizeof(storage[i]), &seed);
+        ids[i] = version_table_intern(&table, storage[i]);
+        if (ids[i] < 0 || strcmp(version_table_string(&table, ids[i]), storage[i])) {
+            printf("'%s'    [FAILED: not interned]\n", storage[i]);
+            failed++;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (version_table_find(&table, storage[i]) != ids[i] || version_table_intern(&table, storage[i]) != ids[i]) {
+            printf("'%s'    [FAILED: ID is not stable]\n", storage[i]);
+            failed++;
+        }
+    }
+    if (version_table_find(&table, "99999.1") != -1 || version_table_intern(&table, "") != -1) {
+        printf("lookup of a missing or invalid version    [FAILED]\n");
+        failed++;
+    }
+    printf("%zu strings interned as %zu IDs\n", n, table.count);
+
+    for (int ranked = 0; ranked < 2; ranked++) {
+        size_t mismatch = 0;
+
+        if (ranked && version_table_rank(&table) < 0) {
+            printf("version_table_rank()    [FAILED]\n");
+            failed++;
+        }
+        for (size_t i = 0; i + 1 < n; i++) {
+            int f = flags[i % (sizeof(flags) / sizeof(flags[0]))];
+            if (version_table_compare(&table, f, ids[i], ids[i + 1]) != version_compare(f, storage[i], storage[i + 1])) {
+                mismatch++;
+            }
+        }
+        printf("comparisons by ID (%s)", ranked ? "ranked" : "parsed");
+        if (mismatch) {
+            printf("    [FAILED: %zu result(s) differ from version_compare()]\n", mismatch);
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+
+    version_table_free(&table);
+    free(storage);
+    free(ids);
+    return failed;
+}
+
+static int run_cases_version_index(size_t n) {
     int failed = 0;
-    for (size_t i = 0; i < size; i++) {
-        int result = 0;
-        struct TestCase_version_compare *test = &tests[i];
-        int op = version_parse_operator(test->op);
-        result = version_compare(op, test->a, test->b);
+    const char *filename = "index.log";
+    char (*buf)[64];
+    const char **versions;
+    vcmp_index index;
+    unsigned seed = 20;
+    FILE *fp;
 
-        printf("%s %s %s is %s (%d)", test->a, test->op, test->b, result ? "TRUE" : "FALSE" , result);
-        if (test->result != result) {
-            printf("    [FAILED: got %d, expected %d]\n", result, test->result);
+    buf = malloc(n * sizeof(*buf));
+    versions = malloc(n * sizeof(*versions));
+    if (!buf || !versions) {
+        free(buf);
+        free(versions);
+        return 1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        test_random_version(buf[i], sizeof(buf[i]), &seed);
+        versions[i] = buf[i];
+    }
+
+    if (version_index_write(filename, versions, n) < 0 || version_index_open(&index, filename) < 0) {
+        printf("unable to write and open an index of %zu versions    [FAILED]\n", n);
+        free(buf);
+        free(versions);
+        return 1;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        vcmp_version expect, version;
+        unsigned char key[VCMP_SORT_KEY_SIZE];
+        size_t j = test_random(&seed) % n;
+
+        version_parse(versions[i], &expect);
+        version_sort_key(&expect, key, sizeof(key));
+        if (index.count != n
+            || version_index_get(&index, i, &version) < 0
+            || memcmp(&version, &expect, sizeof(version))
+            || strcmp(version_index_string(&index, i), versions[i])
+            || memcmp(index.key + i * index.key_size, key, sizeof(key))
+            || version_index_cmp(&index, i, j) != version_cmp(versions[i], versions[j])) {
+            printf("'%s' <=> '%s' index entry does not match    [FAILED]\n", versions[i], versions[j]);
+            failed++;
+        }
+    }
+    printf("%zu versions, %zu component columns\n", index.count, index.components);
+
+    // Corrupted rows are rejected
+    {
+        size_t row = n / 2;
+        size_t ncomponents_at = (size_t) (index.ncomponents + row - (const unsigned char *) index.map);
+        size_t offset_at = (size_t) ((const unsigned char *) (index.string_offset + row)
+                                     - (const unsigned char *) index.map);
+        size_t nul_at = (size_t) (index.string + index.string_offset[row + 1] - 1 - (const char *) index.map);
+        uint64_t offsets[] = {index.string_offset[row + 1] + 1, UINT64_MAX};
+        unsigned char components = (unsigned char) (index.components + 1);
+        struct {
+            const char *name;
+            size_t at;
+            const void *value;
+            size_t size;
+        } corrupt[] = {
+            {"ncomponents past the component columns", ncomponents_at, &components, 1},
+            {"string offset past the next one", offset_at, &offsets[0], sizeof(offsets[0])},
+            {"string offset past the string pool", offset_at, &offsets[1], sizeof(offsets[1])},
+            {"string without its NUL", nul_at, "x", 1},
+        };
+        size_t size = index.map_size;
+        unsigned char *data = malloc(size);
+
+        memcpy(data, index.map, size);
+        version_index_close(&index);
+        for (size_t c = 0; data && c < sizeof(corrupt) / sizeof(corrupt[0]); c++) {
+            fp = fopen(filename, "w");
+            if (!fp) {
+                perror("unable to write corrupted index");
+                break;
+            }
+            fwrite(data, 1, corrupt[c].at, fp);
+            fwrite(corrupt[c].value, 1, corrupt[c].size, fp);
+            fwrite(data + corrupt[c].at + corrupt[c].size, 1, size - corrupt[c].at - corrupt[c].size, fp);
+            fclose(fp);
+            if (!version_index_open(&index, filename)) {
+                printf("index with %s was accepted    [FAILED]\n", corrupt[c].name);
+                version_index_close(&index);
+                failed++;
+            }
+        }
+        // Restore the original for the truncation case
+        fp = fopen(filename, "w");
+        if (data && fp) {
+            fwrite(data, 1, size, fp);
+        }
+        if (fp) {
+            fclose(fp);
+        }
+        free(data);
+    }
+
+    // A truncated file is rejected
+    fp = fopen(filename, "r+");
+    if (fp) {
+        fseek(fp, 0, SEEK_END);
+        if (ftruncate(fileno(fp), ftell(fp) - 1) < 0) {
+            perror("ftruncate");
+        }
+        fclose(fp);
+    }
+    if (!version_index_open(&index, filename)) {
+        printf("truncated index was accepted    [FAILED]\n");
+        version_index_close(&index);
+        failed++;
+    }
+
+    remove(filename);
+    free(buf);
+    free(versions);
+    return failed;
+}
+
+static int run_cases_version_index_scan(size_t n) {
+    int failed = 0;
+    const int isas[] = {VCMP_ISA_SCALAR, VCMP_ISA_SSE2, VCMP_ISA_AVX2, VCMP_ISA_AUTO};
+    const char *names[] = {"scalar", "sse2", "avx2", "auto"};
+    const int flags[] = {GT, LT, EQ, GT | EQ, LT | EQ, NOT | EQ, NOT};
+    const char *edges[] = {"0", "18446744073709551615", "9223372036854775808", "9223372036854775807",
+                           "1.18446744073709551615", "18446744073709551615:1", "1.0zzzzzzzz", "1.2.3.4.5.6.7.8"};
+    const size_t nedges = sizeof(edges) / sizeof(edges[0]);
+    char (*buf)[64];
+    const char **versions;
+    vcmp_version *parsed;
+    uint64_t *mask;
+    vcmp_index index;
+    unsigned seed = 21;
+
+    n += nedges;
+    buf = malloc(n * sizeof(*buf));
+    versions = malloc(n * sizeof(*versions));
+    parsed = malloc(n * sizeof(*parsed));
+    mask = malloc((n + 63) / 64 * sizeof(*mask));
+    if (!buf || !versions || !parsed || !mask) {
+        failed = 1;
+        goto run_cases_version_index_scan_done;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (i < nedges) {
+            snprintf(buf[i], sizeof(buf[i]), "%s", edges[i]);
+        } else {
+            test_random_version(buf[i], sizeof(buf[i]), &seed);
+        }
+        versions[i] = buf[i];
+        version_parse(versions[i], &parsed[i]);
+    }
+    if (version_index_init(&index, versions, n) < 0) {
+        printf("unable to index %zu versions    [FAILED]\n", n);
+        failed = 1;
+        goto run_cases_version_index_scan_done;
+    }
+
+    for (size_t k = 0; k < sizeof(isas) / sizeof(isas[0]); k++) {
+        size_t mismatch = 0;
+
+        if (version_set_isa(isas[k]) < 0) {
+            printf("%s kernel is not supported, SKIPPED\n", names[k]);
+            continue;
+        }
+        // Every edge case, and some random rows, as the right-hand side
+        for (size_t j = 0; j < nedges + 32; j++) {
+            size_t row = j < nedges ? j : test_random(&seed) % n;
+            const vcmp_version *x = &parsed[row];
+
+            for (size_t f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+                long expect = 0;
+                long matches = version_index_scan(&index, flags[f], x, mask);
+
+                for (size_t i = 0; i < n; i++) {
+                    int result = version_compare_parsed(flags[f], &parsed[i], x);
+                    expect += result;
+                    if (result != (int) (mask[i / 64] >> (i % 64) & 1)) {
+                        if (!mismatch++) {
+                            printf("'%s' flags %d against row %zu '%s'    [FAILED]\n",
+                                   versions[row], flags[f], i, versions[i]);
+                        }
+                    }
+                }
+                if (matches != expect) {
+                    mismatch++;
+                }
+            }
+        }
+        printf("%s kernel: %zu mismatches\n", names[k], mismatch);
+        failed += mismatch != 0;
+    }
+    version_set_isa(VCMP_ISA_AUTO);
+
+    if (version_index_scan(&index, 0, &parsed[0], mask) != -1) {
+        printf("invalid flags were accepted    [FAILED]\n");
+        failed++;
+    }
+    version_index_close(&index);
+
+run_cases_version_index_scan_done:
+    free(buf);
+    free(versions);
+    free(parsed);
+    free(mask);
+    return failed;
+}
+
+static int run_cases_version_parse_fuzz(size_t n) {
+    int failed = 0;
+    const char alphabet[] = "0123456789000111999.....----::abczABCZ @\t\xe9\x80";
+    const int isas[] = {VCMP_ISA_SCALAR, VCMP_ISA_SSE2, VCMP_ISA_AVX2, VCMP_ISA_AUTO};
+    const char *names[] = {"scalar", "sse2", "avx2", "auto"};
+    unsigned seed = 7;
+
+    for (size_t k = 0; k < sizeof(isas) / sizeof(isas[0]); k++) {
+        size_t mismatch = 0;
+
+        if (version_set_isa(isas[k]) < 0) {
+            printf("%s tokenizer is not supported, SKIPPED\n", names[k]);
+            continue;
+        }
+        for (size_t i = 0; i < n; i++) {
+            char str[256];
+            size_t len = test_random(&seed) % (sizeof(str) - 1);
+            vcmp_version expected, result;
+            int expected_rc, result_rc;
+
+            // Mostly well-formed versions, with random bytes mixed in
+            if (test_random(&seed) % 2) {
+                size_t pos = 0;
+                while (pos + 24 < len) {
+                    pos += (size_t) snprintf(str + pos, sizeof(str) - pos, "%u%s",
+                                             test_random(&seed) * test_random(&seed), test_random(&seed) % 3 ? "." : "rc");
+                }
+                len = pos;
+            } else {
+                for (size_t j = 0; j < len; j++) {
+                    str[j] = alphabet[test_random(&seed) % (sizeof(alphabet) - 1)];
+                }
+            }
+            str[len] = '\0';
+
+            memset(&expected, 0, sizeof(expected));
+            memset(&result, 0, sizeof(result));
+            expected_rc = version_parse_scalar(str, &expected);
+            result_rc = version_parse(str, &result);
+            if (expected_rc != result_rc || (!expected_rc && memcmp(&expected, &result, sizeof(result)))) {
+                if (!mismatch) {
+                    printf("'%s' (%s)    [FAILED: differs from the scalar parser]\n", str, names[k]);
+                }
+                mismatch++;
+            }
+        }
+        printf("%zu random strings, %s tokenizer", n, names[k]);
+        if (mismatch) {
+            printf("    [FAILED: %zu mismatch(es)]\n", mismatch);
             failed++;
         } else {
             puts("");
         }
     }
+    version_set_isa(VCMP_ISA_AUTO);
     return failed;
 }
 
@@ -179,6 +1565,53 @@ static int run_cases_string(struct TestCase_strings tests[], size_t size, strfn
     return failed;
 }
 
+static int run_cases_string_n(struct TestCase_strings tests[], size_t size) {
+    int failed = 0;
+    for (size_t i = 0; i < size; i++) {
+        struct TestCase_strings *test = &tests[i];
+        char dest[255];
+        size_t len;
+
+        len = vcmp_collapse_whitespace_n(test->s, strlen(test->s), dest);
+
+        printf("'%s' is %s", dest, !strcmp(test->result, dest) ? "CORRECT" : "INCORRECT");
+        if (strcmp(test->result, dest) || len != strlen(test->result)) {
+            printf("    [FAILED: got '%s' (%zu), expected '%s']\n", dest, len, test->result);
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+    return failed;
+}
+
+static int run_cases_token_next_n(void) {
+    int failed = 0;
+    const char *input = "  1.0   >=\t2.0  ";
+    const char *expected[] = {"1.0", ">=", "2.0"};
+    const char *s = input;
+    const char *token;
+    size_t len = strlen(input);
+    size_t token_len;
+    size_t i = 0;
+
+    while ((token = vcmp_token_next_n(&s, &len, &token_len)) != NULL) {
+        printf("'%.*s'", (int) token_len, token);
+        if (i >= 3 || strlen(expected[i]) != token_len || strncmp(expected[i], token, token_len)) {
+            printf("    [FAILED: unexpected token]\n");
+            failed++;
+        } else {
+            puts("");
+        }
+        i++;
+    }
+    if (i != 3) {
+        printf("%zu token(s)    [FAILED: expected 3]\n", i);
+        failed++;
+    }
+    return failed;
+}
+
 char **make_argv(int *argc, char *argv[]) {
     char **args;
     *argc = 0;
@@ -252,7 +1685,7 @@ int run_program(char *argv[]) {
         goto run_program_failed;
     }
 
-    result = entry(argc, args);
+    result = vcmp_entry(argc, args);
 
     fflush(stdout);
     close(o_stdout);
@@ -344,6 +1777,266 @@ static int run_cases_program_standalone(struct TestCase_version_compare tests[],
     return failed;
 }
 
+static int run_cases_program_stream(struct TestCase_version_compare tests[], size_t size, const char *sep) {
+    int failed = 0;
+    const char *filename_in = "stdin.log";
+    const char *filename_out = "stdout.log";
+    char data[255] = {0};
+    int o_stdin, o_stdout;
+    int save_stdin, save_stdout;
+    FILE *fp;
+
+    fp = fopen(filename_in, "w");
+    if (!fp) {
+        perror("unable to open stdin log");
+        return (int) size;
+    }
+    for (size_t i = 0; i < size; i++) {
+        fprintf(fp, "%s%s%s%s%s\n", tests[i].a, sep, tests[i].op, sep, tests[i].b);
+    }
+    fclose(fp);
+
+    o_stdin = open(filename_in, O_RDONLY);
+    o_stdout = open(filename_out, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (o_stdin == -1 || o_stdout == -1) {
+        perror("unable to open stdin/stdout log");
+        return (int) size;
+    }
+
+    save_stdin = dup(fileno(stdin));
+    save_stdout = dup(fileno(stdout));
+    fflush(stdout);
+    dup2(o_stdin, fileno(stdin));
+    dup2(o_stdout, fileno(stdout));
+
+    vcmp_entry(2, (char *[]){"version_compare", "--stdin", NULL});
+
+    fflush(stdout);
+    dup2(save_stdin, fileno(stdin));
+    dup2(save_stdout, fileno(stdout));
+    close(save_stdin);
+    close(save_stdout);
+    close(o_stdin);
+    close(o_stdout);
+    clearerr(stdin);
+
+    fp = fopen(filename_out, "r");
+    if (!fp) {
+        perror("unable to open output log file");
+        return (int) size;
+    }
+    for (size_t i = 0; i < size; i++) {
+        int result = 0;
+        struct TestCase_version_compare *test = &tests[i];
+
+        if (!fgets(data, sizeof(data) - 1, fp)) {
+            printf("%s %s %s    [FAILED: no output recorded]\n", test->a, test->op, test->b);
+            failed++;
+            continue;
+        }
+        result = (int) strtol(data, NULL, 10);
+
+        printf("%s %s %s is %s (%d)", test->a, test->op, test->b, result ? "TRUE" : "FALSE", result);
+        if (test->result != result) {
+            printf("    [FAILED: got %d, expected %d]\n", result, test->result);
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+    fclose(fp);
+    remove(filename_in);
+    remove(filename_out);
+    return failed;
+}
+
+static int run_cases_program_manifest(struct TestCase_version_compare tests[], size_t size) {
+    int failed = 0;
+    const char *filename_in = "manifest.log";
+    const char *filename_out = "stdout.log";
+    char data[255] = {0};
+    size_t expect_failed, checked, count, lineno;
+    int o_stdout, save_stdout, result;
+    FILE *fp;
+
+    // Line 1 is a comment and line 2 is blank, so test i is on line i + 3.
+    // The last line has no trailing newline.
+    fp = fopen(filename_in, "w");
+    if (!fp) {
+        perror("unable to open manifest log");
+        return (int) size;
+    }
+    fprintf(fp, "# name installed operator required\n\n");
+    for (size_t i = 0; i < size; i++) {
+        fprintf(fp, "pkg%zu  %s\t%s %s%s", i, tests[i].a, tests[i].op, tests[i].b, i + 1 < size ? "\n" : "");
+    }
+    fclose(fp);
+
+    o_stdout = open(filename_out, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (o_stdout == -1) {
+        perror("unable to open stdout log");
+        return (int) size;
+    }
+    save_stdout = dup(fileno(stdout));
+    fflush(stdout);
+    dup2(o_stdout, fileno(stdout));
+
+    result = vcmp_entry(3, (char *[]){"version_compare", "--file", (char *) filename_in, NULL});
+
+    fflush(stdout);
+    dup2(save_stdout, fileno(stdout));
+    close(save_stdout);
+    close(o_stdout);
+
+    expect_failed = 0;
+    for (size_t i = 0; i < size; i++) {
+        expect_failed += tests[i].result != 1;
+    }
+
+    fp = fopen(filename_out, "r");
+    if (!fp) {
+        perror("unable to open output log file");
+        return (int) size;
+    }
+    for (size_t i = 0; i < size; i++) {
+        struct TestCase_version_compare *test = &tests[i];
+
+        if (test->result == 1) {
+            continue;
+        }
+        lineno = 0;
+        if (fgets(data, sizeof(data) - 1, fp)) {
+            lineno = strtoul(data, NULL, 10);
+        }
+
+        printf("%s %s %s is listed on line %zu", test->a, test->op, test->b, lineno);
+        if (lineno != i + 3) {
+            printf("    [FAILED: expected line %zu]\n", i + 3);
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+
+    count = checked = 0;
+    if (!fgets(data, sizeof(data) - 1, fp) || sscanf(data, "%zu of %zu checks failed", &count, &checked) != 2) {
+        data[0] = '\0';
+    }
+    printf("summary: %s", data[0] ? data : "(none)\n");
+    if (count != expect_failed || checked != size || result != (expect_failed ? 1 : 0)) {
+        printf("    [FAILED: expected %zu of %zu checks failed, exit %d]\n", expect_failed, size, expect_failed ? 1 : 0);
+        failed++;
+    }
+
+    fclose(fp);
+    remove(filename_in);
+    remove(filename_out);
+    return failed;
+}
+
+static int run_cases_program_serve(struct TestCase_version_compare tests[], size_t size) {
+    int failed = 0;
+    const char *path = "serve.sock";
+    struct sockaddr_un addr;
+    char request[BUFSIZ], reply[16];
+    int fd[2], status;
+    FILE *fp[2];
+    pid_t pid;
+
+    fflush(stdout);
+    pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return (int) size;
+    }
+    if (!pid) {
+        _exit(vcmp_entry(3, (char *[]){"version_compare", "--serve", (char *) path, NULL}) ? 1 : 0);
+    }
+
+    // Two clients, connected once the server is listening
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    for (int i = 0; i < 2; i++) {
+        fd[i] = -1;
+        for (int attempt = 0; fd[i] < 0 && attempt < 200; attempt++) {
+            fd[i] = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (connect(fd[i], (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+                close(fd[i]);
+                fd[i] = -1;
+                usleep(10000);
+            }
+        }
+        if (fd[i] < 0) {
+            perror("unable to connect to server");
+            kill(pid, SIGKILL);
+            waitpid(pid, NULL, 0);
+            return (int) size;
+        }
+        fp[i] = fdopen(fd[i], "r+");
+    }
+
+    // Pipeline every request on one client, and interleave single requests
+    // on the other
+    for (size_t i = 0; i < size; i++) {
+        fprintf(fp[0], "%s %s %s\n", tests[i].a, tests[i].op, tests[i].b);
+    }
+    fflush(fp[0]);
+    for (size_t i = 0; i < size; i++) {
+        struct TestCase_version_compare *test = &tests[i];
+        int result[2] = {-2, -2};
+
+        snprintf(request, sizeof(request), "%s %s %s\n", test->a, test->op, test->b);
+        fputs(request, fp[1]);
+        fflush(fp[1]);
+        for (int c = 0; c < 2; c++) {
+            if (fgets(reply, sizeof(reply), fp[c])) {
+                result[c] = (int) strtol(reply, NULL, 10);
+            }
+        }
+
+        printf("%s %s %s is %s (%d)", test->a, test->op, test->b, result[0] ? "TRUE" : "FALSE", result[0]);
+        if (test->result != result[0] || test->result != result[1]) {
+            printf("    [FAILED: got %d and %d, expected %d]\n", result[0], result[1], test->result);
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+    fclose(fp[0]);
+    fclose(fp[1]);
+
+    kill(pid, SIGTERM);
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+        printf("server did not shut down cleanly    [FAILED]\n");
+        failed++;
+    }
+    if (!access(path, F_OK)) {
+        printf("server left %s behind    [FAILED]\n", path);
+        remove(path);
+        failed++;
+    }
+    return failed;
+}
+
+static int run_cases_program_constraint(struct TestCase_version_constraint tests[], size_t size) {
+    int failed = 0;
+    for (size_t i = 0; i < size; i++) {
+        int result = 0;
+        struct TestCase_version_constraint *test = &tests[i];
+        result = run_program((char *[]){test->version, test->expr, NULL});
+
+        printf("'%s' satisfies '%s' is %s (%d)", test->version, test->expr, result ? "TRUE" : "FALSE", result);
+        if (test->result != result) {
+            printf("    [FAILED: got %d, expected %d]\n", result, test->result);
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+    return failed;
+}
+
 int main() {
     int failed = 0;
 
@@ -353,18 +2046,85 @@ int main() {
     printf("\nTEST version_compare errors()\n");
     failed += run_cases_version_compare(error_cases_version_compare,
                                         sizeof(error_cases_version_compare) / sizeof(error_cases_version_compare[0]));
-    printf("\nTEST collapse_whitespace()\n");
+    printf("\nTEST version_compare() long versions\n");
+    failed += run_cases_version_compare(test_cases_version_compare_long,
+                                        sizeof(test_cases_version_compare_long) / sizeof(test_cases_version_compare_long[0]));
+    printf("\nTEST version_compare_n()\n");
+    failed += run_cases_version_compare_n(test_cases_version_compare,
+                                          sizeof(test_cases_version_compare) / sizeof(test_cases_version_compare[0]));
+    failed += run_cases_version_compare_n(error_cases_version_compare,
+                                          sizeof(error_cases_version_compare) / sizeof(error_cases_version_compare[0]));
+    failed += run_cases_version_compare_n(test_cases_version_compare_long,
+                                          sizeof(test_cases_version_compare_long) / sizeof(test_cases_version_compare_long[0]));
+    printf("\nTEST version_sum()\n");
+    failed += run_cases_version_sum(test_cases_version_sum,
+                                    sizeof(test_cases_version_sum) / sizeof(test_cases_version_sum[0]));
+    printf("\nTEST version_cache_*()\n");
+    failed += run_cases_version_cache(test_cases_version_compare,
+                                      sizeof(test_cases_version_compare) / sizeof(test_cases_version_compare[0]));
+    printf("\nTEST version_satisfies_ctx() allocations\n");
+    failed += run_cases_version_context_noalloc(test_cases_version_constraint,
+                                                sizeof(test_cases_version_constraint) / sizeof(test_cases_version_constraint[0]));
+    printf("\nTEST concurrent comparisons\n");
+    failed += run_cases_version_threads(8, 200);
+    printf("\nTEST version_stats_*()\n");
+    failed += run_cases_version_stats(test_cases_version_compare,
+                                      sizeof(test_cases_version_compare) / sizeof(test_cases_version_compare[0]));
+    printf("\nTEST version_cmp()\n");
+    failed += run_cases_version_cmp(test_cases_version_cmp,
+                                    sizeof(test_cases_version_cmp) / sizeof(test_cases_version_cmp[0]));
+    printf("\nTEST version_parse() long tags\n");
+    failed += run_cases_version_parse_long(test_cases_version_parse_long,
+                                           sizeof(test_cases_version_parse_long) / sizeof(test_cases_version_parse_long[0]));
+    printf("\nTEST version_cmp_scheme()\n");
+    failed += run_cases_version_scheme(test_cases_version_scheme,
+                                       sizeof(test_cases_version_scheme) / sizeof(test_cases_version_scheme[0]));
+    printf("\nTEST version_index_*()\n");
+    failed += run_cases_version_index(20000);
+    printf("\nTEST version_index_scan()\n");
+    failed += run_cases_version_index_scan(5000);
+    printf("\nTEST version_parse() tokenizers\n");
+    failed += run_cases_version_parse_fuzz(50000);
+    printf("\nTEST version_compare_many()\n");
+    failed += run_cases_version_compare_many(50000);
+    printf("\nTEST version_sort_key()\n");
+    failed += run_cases_version_sort_key(50000);
+    printf("\nTEST version_sort()\n");
+    failed += run_cases_version_sort(20000);
+    printf("\nTEST version_satisfies()\n");
+    failed += run_cases_version_constraint(test_cases_version_constraint,
+                                           sizeof(test_cases_version_constraint) / sizeof(test_cases_version_constraint[0]));
+    failed += run_cases_version_constraint_random(5000);
+    printf("\nTEST version_select()\n");
+    failed += run_cases_version_select(2000);
+    printf("\nTEST version_table()\n");
+    failed += run_cases_version_table(20000);
+    printf("\nTEST version_compare_parsed()\n");
+    failed += run_cases_version_compare_parsed(test_cases_version_compare,
+                                               sizeof(test_cases_version_compare) / sizeof(test_cases_version_compare[0]));
+    printf("\nTEST version_compare_parsed errors()\n");
+    failed += run_cases_version_compare_parsed(error_cases_version_compare,
+                                               sizeof(error_cases_version_compare) / sizeof(error_cases_version_compare[0]));
+    printf("\nTEST version_compare() allocations\n");
+    failed += run_cases_version_compare_noalloc(test_cases_version_compare,
+                                                sizeof(test_cases_version_compare) / sizeof(test_cases_version_compare[0]));
+    printf("\nTEST vcmp_collapse_whitespace()\n");
     failed += run_cases_string(test_cases_collapse_whitespace,
                                sizeof(test_cases_collapse_whitespace) / sizeof(test_cases_collapse_whitespace[0]),
-                               &collapse_whitespace);
-    printf("\nTEST lstrip()\n");
+                               &vcmp_collapse_whitespace);
+    printf("\nTEST vcmp_collapse_whitespace_n()\n");
+    failed += run_cases_string_n(test_cases_collapse_whitespace,
+                                 sizeof(test_cases_collapse_whitespace) / sizeof(test_cases_collapse_whitespace[0]));
+    printf("\nTEST vcmp_token_next_n()\n");
+    failed += run_cases_token_next_n();
+    printf("\nTEST vcmp_lstrip()\n");
     failed += run_cases_string(test_cases_lstrip,
                                sizeof(test_cases_lstrip) / sizeof(test_cases_lstrip[0]),
-                               &lstrip);
-    printf("\nTEST rstrip()\n");
+                               &vcmp_lstrip);
+    printf("\nTEST vcmp_rstrip()\n");
     failed += run_cases_string(test_cases_rstrip,
                                sizeof(test_cases_rstrip) / sizeof(test_cases_rstrip[0]),
-                               &rstrip);
+                               &vcmp_rstrip);
 
     printf("\nTEST main program entry point (split string)\n");
     failed += run_cases_program_split(test_cases_version_compare,
@@ -382,5 +2142,31 @@ int main() {
     failed += run_cases_program_standalone(error_cases_version_compare,
                                         sizeof(error_cases_version_compare) / sizeof(error_cases_version_compare[0]));
 
+    printf("\nTEST main program entry point (constraint)\n");
+    failed += run_cases_program_constraint(test_cases_version_constraint,
+                                           sizeof(test_cases_version_constraint) / sizeof(test_cases_version_constraint[0]));
+
+    printf("\nTEST main program entry point (stdin)\n");
+    failed += run_cases_program_stream(test_cases_version_compare,
+                                       sizeof(test_cases_version_compare) / sizeof(test_cases_version_compare[0]), " ");
+
+    printf("\nTEST main program entry point (stdin, tab-separated)\n");
+    failed += run_cases_program_stream(test_cases_version_compare,
+                                       sizeof(test_cases_version_compare) / sizeof(test_cases_version_compare[0]), "\t");
+
+    printf("\nTEST main program entry point errors (stdin)\n");
+    failed += run_cases_program_stream(error_cases_version_compare,
+                                       sizeof(error_cases_version_compare) / sizeof(error_cases_version_compare[0]), " ");
+
+    printf("\nTEST main program entry point (server)\n");
+    failed += run_cases_program_serve(test_cases_version_compare,
+                                      sizeof(test_cases_version_compare) / sizeof(test_cases_version_compare[0]));
+    failed += run_cases_program_serve(error_cases_version_compare,
+                                      sizeof(error_cases_version_compare) / sizeof(error_cases_version_compare[0]));
+
+    printf("\nTEST main program entry point (manifest)\n");
+    failed += run_cases_program_manifest(test_cases_version_compare,
+                                         sizeof(test_cases_version_compare) / sizeof(test_cases_version_compare[0]));
+
     return failed != 0;
 }
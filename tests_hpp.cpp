@@ -0,0 +1,71 @@
+#include <cstdio>
+#include <cstring>
+#include "version_compare.hpp"
+
+using namespace vcmp::literals;
+
+// Ordering mistakes in the constexpr parser are compile errors
+static_assert("2.17"_v < "2.18"_v, "minor");
+static_assert("1.0.150"_v < "2.0.49"_v, "lossy sum");
+static_assert("1.0"_v == "1.0.0.0"_v, "trailing zeros");
+static_assert("1.0a"_v > "1.0"_v, "tag sorts above no tag");
+static_assert("1.0a"_v < "1.0b"_v, "tags");
+static_assert("1a2"_v == "1a.2"_v, "digit after tag");
+static_assert("1:2022.1"_v > "2022.4"_v, "epoch");
+static_assert("0:1.0"_v == "1.0"_v, "zero epoch");
+static_assert("18446744073709551616"_v == "18446744073709551615"_v, "saturation");
+static_assert(" \t1.2.3 extra"_v == "1.2.3"_v, "leading whitespace, trailing garbage");
+static_assert("2.17"_v.compare(GT | EQ, "2.17"_v), ">=");
+static_assert(!"2.17"_v.compare(NOT | EQ, "2.17.0"_v), "!=");
+static_assert(vcmp::version("1.2.3").get().count == 3, "count");
+static_assert(vcmp::version("3:1").get().has_epoch, "has_epoch");
+
+struct TestCase_version_hpp {
+    const char *str;
+};
+
+static struct TestCase_version_hpp test_cases_version_hpp[] = {
+    {"0"},
+    {"1.2.3"},
+    {"1.0.0.0"},
+    {"1:2022.1"},
+    {"2.0.0rc1"},
+    {"1.0-beta.2"},
+    {"1a2b3c"},
+    {"1.2.abcdefgh"},
+    {"  7.8.9  "},
+    {"1.2.3+build.5"},
+    {"4294967296.18446744073709551616"},
+    {"1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16"},
+};
+
+static int run_cases_version_hpp(struct TestCase_version_hpp tests[], size_t size) {
+    int failed = 0;
+    for (size_t i = 0; i < size; i++) {
+        vcmp_version parsed;
+        struct TestCase_version_hpp *test = &tests[i];
+        vcmp::version constant(test->str);
+
+        printf("'%s' has %d component(s)", test->str, constant.get().count);
+        if (version_parse(test->str, &parsed) < 0 || memcmp(&parsed, &constant.get(), sizeof(parsed))) {
+            printf("    [FAILED: differs from version_parse()]\n");
+            failed++;
+        } else if (vcmp::compare(EQ, test->str, constant) != 1 || vcmp::version::parse(test->str) != constant) {
+            printf("    [FAILED: not equal to itself]\n");
+            failed++;
+        } else {
+            puts("");
+        }
+    }
+    return failed;
+}
+
+int main() {
+    int failed = 0;
+
+    printf("\nTEST vcmp::version\n");
+    failed += run_cases_version_hpp(test_cases_version_hpp,
+                                    sizeof(test_cases_version_hpp) / sizeof(test_cases_version_hpp[0]));
+
+    return failed != 0;
+}
@@ -1,82 +1,415 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <ctype.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <signal.h>
+#include <errno.h>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
 #include "version_compare.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VCMP_HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+// Number of pairs a worker evaluates at a time. Small enough that a chunk's
+// input pointers and results stay in cache.
+#define VCMP_BATCH_CHUNK 2048
+
+// Character at p, or '\0' past the end of a span. end is NULL for
+// NUL-terminated strings.
+#define VERSION_AT(p, end) ((end) && (p) >= (end) ? '\0' : *(p))
+
+// Entries per cache set. A lookup compares at most this many keys.
+#define VCMP_CACHE_WAYS 4
+#define VCMP_CACHE_MAGIC "vcmpcache1"
+
+// Longest request line --serve accepts. Longer lines are answered with -1.
+#define VCMP_SERVE_LINE_MAX 4096
+// Stop reading from a client that has this many bytes of unsent replies
+#define VCMP_SERVE_BACKLOG 65536
+
+#define VCMP_INDEX_MAGIC "VCMPIDX"
+#define VCMP_INDEX_BYTE_ORDER 0x01020304u
+// Alignment of each column in an index file
+#define VCMP_INDEX_ALIGN 64
+
+#if defined(VCMP_ENABLE_STATS)
+struct version_stats_block {
+    vcmp_stats stats;
+    struct version_stats_block *next;
+};
+
+static pthread_mutex_t version_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t version_stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t version_stats_key;
+static struct version_stats_block *version_stats_blocks;
+// Counters of threads that have exited
+static vcmp_stats version_stats_retired;
+static __thread struct version_stats_block *version_stats_local;
+
+/**
+ * Add the counters of src to dest
+ */
+static void version_stats_sum(vcmp_stats *dest, const vcmp_stats *src) {
+    const uint64_t *from = (const uint64_t *) src;
+    uint64_t *to = (uint64_t *) dest;
+
+    for (size_t i = 0; i < sizeof(*src) / sizeof(uint64_t); i++) {
+        to[i] += __atomic_load_n(&from[i], __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Retire the counters of an exiting thread
+ * @param arg the thread's counter block
+ */
+static void version_stats_exit(void *arg) {
+    struct version_stats_block *block = arg;
+    struct version_stats_block **pos;
+
+    pthread_mutex_lock(&version_stats_lock);
+    for (pos = &version_stats_blocks; *pos; pos = &(*pos)->next) {
+        if (*pos == block) {
+            *pos = block->next;
+            break;
+        }
+    }
+    version_stats_sum(&version_stats_retired, &block->stats);
+    pthread_mutex_unlock(&version_stats_lock);
+    free(block);
+}
+
+static void version_stats_init(void) {
+    pthread_key_create(&version_stats_key, version_stats_exit);
+}
+
+/**
+ * Get the calling thread's counters, registering them on first use
+ * @return counters
+ * @return NULL if they could not be allocated
+ */
+static vcmp_stats *version_stats_thread(void) {
+    struct version_stats_block *block = version_stats_local;
+
+    if (block) {
+        return &block->stats;
+    }
+
+    pthread_once(&version_stats_once, version_stats_init);
+    block = calloc(1, sizeof(*block));
+    if (!block) {
+        return NULL;
+    }
+    pthread_mutex_lock(&version_stats_lock);
+    block->next = version_stats_blocks;
+    version_stats_blocks = block;
+    pthread_mutex_unlock(&version_stats_lock);
+    pthread_setspecific(version_stats_key, block);
+    version_stats_local = block;
+    return &block->stats;
+}
+
+/**
+ * Read a timestamp for the cycle counters
+ * @return TSC ticks on x86, nanoseconds elsewhere
+ */
+static uint64_t version_stats_clock(void) {
+#if defined(VCMP_HAVE_X86_SIMD)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+// Only the owning thread writes its counters. Other threads read them
+// while aggregating, so stores are atomic (but need no lock prefix).
+#define VERSION_STATS_ADD(stats, field, n) \
+    __atomic_store_n(&(stats)->field, (stats)->field + (n), __ATOMIC_RELAXED)
+
+/**
+ * Count a parse
+ * @param len bytes of input
+ * @param result parser return value
+ * @param start version_stats_clock() when the parse started
+ */
+static void version_stats_parse(size_t len, int result, uint64_t start) {
+    vcmp_stats *stats = version_stats_thread();
+
+    if (!stats) {
+        return;
+    }
+    VERSION_STATS_ADD(stats, parses, 1);
+    VERSION_STATS_ADD(stats, parse_failures, result < 0);
+    VERSION_STATS_ADD(stats, bytes_scanned, len);
+    VERSION_STATS_ADD(stats, parse_cycles, version_stats_clock() - start);
+}
+
+/**
+ * Count a comparison
+ * @param flags version operators
+ * @param result comparison return value
+ * @param start version_stats_clock() when the comparison started
+ */
+static void version_stats_compare(int flags, int result, uint64_t start) {
+    vcmp_stats *stats = version_stats_thread();
+
+    if (!stats) {
+        return;
+    }
+    VERSION_STATS_ADD(stats, compares, 1);
+    if (flags > 0) {
+        VERSION_STATS_ADD(stats, compares_gt, !!(flags & GT));
+        VERSION_STATS_ADD(stats, compares_lt, !!(flags & LT));
+        VERSION_STATS_ADD(stats, compares_eq, !!(flags & EQ));
+        VERSION_STATS_ADD(stats, compares_not, !!(flags & NOT));
+    }
+    VERSION_STATS_ADD(stats, compare_failures, result < 0);
+    VERSION_STATS_ADD(stats, compare_cycles, version_stats_clock() - start);
+}
+
+/**
+ * Count the two versions a string comparison walks
+ *
+ * Walks parse both versions without producing a vcmp_version. A failed
+ * walk counts one parse failure, the side that failed is not known.
+ *
+ * @param len bytes of both versions scanned
+ * @param result comparison return value
+ * @param start version_stats_clock() when the walk started
+ */
+static void version_stats_walk(size_t len, int result, uint64_t start) {
+    vcmp_stats *stats = version_stats_thread();
+
+    if (!stats) {
+        return;
+    }
+    VERSION_STATS_ADD(stats, parses, 2);
+    VERSION_STATS_ADD(stats, parse_failures, result == VCMP_CMP_ERROR);
+    VERSION_STATS_ADD(stats, bytes_scanned, len);
+    VERSION_STATS_ADD(stats, parse_cycles, version_stats_clock() - start);
+}
+
+#define VERSION_STATS_START(start) uint64_t start = version_stats_clock()
+#define VERSION_STATS_PARSE(len, result, start) version_stats_parse(len, result, start)
+#define VERSION_STATS_WALK(len, result, start) version_stats_walk(len, result, start)
+#define VERSION_STATS_COMPARE(flags, result, start) version_stats_compare(flags, result, start)
+#else
+#define VERSION_STATS_START(start)
+#define VERSION_STATS_PARSE(len, result, start) ((void) 0)
+#define VERSION_STATS_WALK(len, result, start) ((void) 0)
+#define VERSION_STATS_COMPARE(flags, result, start) ((void) 0)
+#endif
+
+/**
+ * Read the library counters, summed over all threads
+ *
+ * Counters are only kept when the library is built with VCMP_ENABLE_STATS.
+ * A string comparison counts as a comparison and a parse of each version,
+ * so its compare cycles include those parse cycles.
+ *
+ * @param stats destination (zeroed when statistics are disabled)
+ * @return 0 on success
+ * @return -1 if statistics are disabled
+ */
+int version_stats_get(vcmp_stats *stats) {
+    if (!stats) {
+        return -1;
+    }
+    memset(stats, 0, sizeof(*stats));
+#if defined(VCMP_ENABLE_STATS)
+    pthread_mutex_lock(&version_stats_lock);
+    version_stats_sum(stats, &version_stats_retired);
+    for (struct version_stats_block *block = version_stats_blocks; block; block = block->next) {
+        version_stats_sum(stats, &block->stats);
+    }
+    pthread_mutex_unlock(&version_stats_lock);
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/**
+ * Zero the library counters
+ *
+ * Counts made by other threads while the reset is in progress may survive
+ * it.
+ */
+void version_stats_reset(void) {
+#if defined(VCMP_ENABLE_STATS)
+    pthread_mutex_lock(&version_stats_lock);
+    memset(&version_stats_retired, 0, sizeof(version_stats_retired));
+    for (struct version_stats_block *block = version_stats_blocks; block; block = block->next) {
+        uint64_t *counter = (uint64_t *) &block->stats;
+        for (size_t i = 0; i < sizeof(block->stats) / sizeof(uint64_t); i++) {
+            __atomic_store_n(&counter[i], 0, __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&version_stats_lock);
+#endif
+}
+
+/**
+ * Determine whether a span consists of only whitespace, or not
+ * @param s input span
+ * @param len length of s
+ * @return 0 if span is not empty
+ * @return 1 if span is empty
+ */
+int vcmp_isempty_n(const char *s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (!isblank((unsigned char) s[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
 /**
  * Determine whether a string consists of only whitespace, or not
  * @parm str string to check for whitespace
  * @return 0 if string is not empty
  * @return 1 if string is empty
  */
-int isempty(char *str) {
-    char *ptr;
-    size_t len;
+int vcmp_isempty(const char *str) {
+    const char *ptr;
 
     ptr = str;
-    len = strlen(ptr);
-    while (isblank(*ptr)) {
-        len--;
+    while (isblank((unsigned char) *ptr)) {
         ptr++;
     }
-    return (int)(len == 0);
+    return *ptr == '\0';
 }
 
 /**
- * Remove leading whitespace from string
- * @param s input string
- * @return pointer to string
+ * Skip leading whitespace of a span without modifying it
+ * @param s input span
+ * @param len length of s, updated to the length of the result
+ * @return pointer to the first non-whitespace character
  */
-char *lstrip(char **s) {
-    char *orig;
-    char *end;
+const char *vcmp_lstrip_n(const char *s, size_t *len) {
+    while (*len && isblank((unsigned char) *s)) {
+        s++;
+        (*len)--;
+    }
+    return s;
+}
 
-    orig = (*s);
-    if (!isblank(*(*s)) || *(*s) == '\0') {
-        return (*s);
+/**
+ * Measure a span without its trailing whitespace, without modifying it
+ * @param s input span
+ * @param len length of s
+ * @return length of s without trailing whitespace
+ */
+size_t vcmp_rstrip_n(const char *s, size_t len) {
+    while (len && isblank((unsigned char) s[len - 1])) {
+        len--;
     }
+    return len;
+}
+
+/**
+ * Reduce multiple whitespace between characters of a span in a single pass
+ *
+ * Leading and trailing whitespace is removed and every run of whitespace is
+ * replaced by its first character. The result is written to dest followed by
+ * a terminator, dest must hold len + 1 bytes. dest may be s itself, because
+ * the write position never passes the read position.
+ *
+ * @param s input span
+ * @param len length of s
+ * @param dest destination
+ * @return length of the result
+ */
+size_t vcmp_collapse_whitespace_n(const char *s, size_t len, char *dest) {
+    const char *end;
+    size_t pos;
+    int blank;
 
-    while (isblank(*(*s)) && *(*s) != '\0') {
-        end = (*s);
-        (*s)++;
+    s = vcmp_lstrip_n(s, &len);
+    len = vcmp_rstrip_n(s, len);
+    end = s + len;
+
+    pos = 0;
+    blank = 0;
+    for (; s < end; s++) {
+        if (isblank((unsigned char) *s)) {
+            if (blank) {
+                continue;
+            }
+            blank = 1;
+        } else {
+            blank = 0;
+        }
+        dest[pos++] = *s;
     }
-    memmove(orig, (*s), strlen(end));
+    dest[pos] = '\0';
+    return pos;
+}
 
-    (*s) = orig;
-    return (*s);
+/**
+ * Consume the next whitespace-delimited token of a span without modifying it
+ * @param s cursor into the span, advanced past the token
+ * @param len remaining length of the span, updated
+ * @param token_len destination for the length of the token
+ * @return pointer to the token
+ * @return NULL if there are no more tokens
+ */
+const char *vcmp_token_next_n(const char **s, size_t *len, size_t *token_len) {
+    const char *token;
+
+    token = vcmp_lstrip_n(*s, len);
+    *token_len = 0;
+    while (*token_len < *len && !isblank((unsigned char) token[*token_len])) {
+        (*token_len)++;
+    }
+
+    *s = token + *token_len;
+    *len -= *token_len;
+    return *token_len ? token : NULL;
 }
 
 /**
- * Remove tailing whitespace from string
+ * Remove leading whitespace from string
  * @param s input string
  * @return pointer to string
  */
-char *rstrip(char **s) {
-    char *orig;
-    char *end;
+char *vcmp_lstrip(char **s) {
     size_t len;
+    const char *start;
 
-    orig = (*s);
-    len = strlen((*s));
-    if (len > 1) {
-        // Jump to end of the string
-        (*s) = (*s) + len - 1;
-    }
-
-    if (!isblank(*(*s)) || *(*s) == '\0') {
-        (*s) = orig;
-        return (*s);
-    }
-
-    while (len != 0 && isblank(*(*s)) && *(*s) != '\0') {
-        end = (*s);
-        (*s)--;
-        --len;
+    len = strlen(*s);
+    start = vcmp_lstrip_n(*s, &len);
+    if (start != *s) {
+        memmove(*s, start, len + 1);
     }
-    *end = '\0';
+    return (*s);
+}
 
-    (*s) = orig;
+/**
+ * Remove tailing whitespace from string
+ * @param s input string
+ * @return pointer to string
+ */
+char *vcmp_rstrip(char **s) {
+    (*s)[vcmp_rstrip_n(*s, strlen(*s))] = '\0';
     return (*s);
 }
 
@@ -85,73 +418,86 @@ char *rstrip(char **s) {
  * @param s input string
  * @return pointer to string
  */
-char *collapse_whitespace(char **s) {
-    char *orig;
-    char *space;
-
-    lstrip(s);
-    rstrip(s);
-
-    space = NULL;
-    orig = (*s);
-    while (*(*s) != '\0') {
-        char *space_next;
+char *vcmp_collapse_whitespace(char **s) {
+    vcmp_collapse_whitespace_n(*s, strlen(*s), *s);
+    return (*s);
+}
 
-        if (space) {
-            int numspace = 0;
-            while (isblank(*space) && *space != '\0') {
-                numspace++;
-                space++;
-            }
+/**
+ * Convert the start of a span to an unsigned long the way strtoul() does
+ * @param str input span
+ * @param end end of the span
+ * @param stop destination for the first unconverted character (str if none)
+ * @return converted value
+ */
+static unsigned long version_strtoul_n(const char *str, const char *end, const char **stop) {
+    const char *ptr;
+    unsigned long value;
+    int negative, overflow;
 
-            memmove((*s), space, strlen(space) - 1 + numspace);
-            space = NULL;
-        }
+    ptr = str;
+    while (ptr < end && isspace((unsigned char) *ptr)) {
+        ptr++;
+    }
+    negative = 0;
+    if (ptr < end && (*ptr == '+' || *ptr == '-')) {
+        negative = *ptr == '-';
+        ptr++;
+    }
+    if (ptr == end || !isdigit((unsigned char) *ptr)) {
+        *stop = str;
+        return 0;
+    }
 
-        space_next = (*s) + 1;
-        if (isblank(*(*s)) && (space_next != NULL && isblank(*space_next))) {
-            space = (*s);
-            (*s)++;
-            continue;
+    value = 0;
+    overflow = 0;
+    while (ptr < end && isdigit((unsigned char) *ptr)) {
+        unsigned digit = (unsigned) (*ptr - '0');
+        if (value > (ULONG_MAX - digit) / 10) {
+            overflow = 1;
+        } else {
+            value = value * 10 + digit;
         }
+        ptr++;
+    }
 
-        (*s)++;
+    *stop = ptr;
+    if (overflow) {
+        return ULONG_MAX;
     }
-    (*s) = orig;
-    return (*s);
+    return negative ? -value : value;
 }
 
 /**
- * Sum each part of a '.'-delimited version string
- * @param str version string
- * @return sum of each part
- * @return -1 on error
+ * Sum each part of a version span without counting it
+ * @see version_sum_n()
  */
-int version_sum(const char *str) {
-    int i, result, epoch;
-    char *s, *ptr, *end;
+static int version_sum_span(const char *str, size_t len) {
+    uint64_t result;
+    int i, epoch;
+    const char *ptr, *end, *stop;
 
-    if (!str || isempty(str)) {
+    if (!str || vcmp_isempty_n(str, len)) {
         return -1;
     }
 
     result = 0;
     epoch = 0;
-    s = strdup(str);
-    if (!s) {
-        return -1;
-    }
-    ptr = s;
-    end = ptr;
+    ptr = str;
+    end = str + len;
+    stop = ptr;
 
     // Parsing stops at the first non-alpha, non-'.' character
     // Digits are processed until the first invalid character
     // I'm torn whether this should be considered an error
     i = 0;
-    while (end != NULL) {
-        int tmp_result = 0;
-
-        tmp_result = (int) strtoul(ptr, &end, 10);
+    while (stop != NULL) {
+        // Anything above INT_MAX saturates the sum anyway, capping the
+        // component keeps the arithmetic below in range
+        uint64_t tmp_result = version_strtoul_n(ptr, end, &stop);
+        if (tmp_result > INT_MAX) {
+            tmp_result = INT_MAX;
+        }
 
         // Circumvent a bug which allows a smaller version to be greater
         // than a larger version
@@ -161,56 +507,91 @@ int version_sum(const char *str) {
         // Correction:
         //   ((1 * EPOCH_MOD) + 1).0.3 = 104
         //   ((2 * EPOCH_MOD) + 2).0.0 = 202
-        if (!i && tmp_result && *end != ':') {
+        if (!i && tmp_result && VERSION_AT(stop, end) != ':') {
             result += tmp_result * EPOCH_MOD;
             i++;
         }
 
-        ptr = end;
-        if (*ptr == '.' || *ptr == '-') {
+        ptr = stop;
+        if (VERSION_AT(ptr, end) == '.' || VERSION_AT(ptr, end) == '-') {
             ptr++;
         }
-        else if (!epoch && *ptr == ':') {
+        else if (!epoch && VERSION_AT(ptr, end) == ':') {
             epoch = 1;
             result += EPOCH_MOD;
             ptr++;
         }
-        else if (isalpha(*ptr)) {
-            result += *ptr - ('a' - 1);
+        else if (isalpha((unsigned char) VERSION_AT(ptr, end))) {
+            // Upper case letters count negative, as they always have,
+            // but do not take the sum below zero
+            int letter = *ptr - ('a' - 1);
+            result = letter < 0 && (uint64_t) -letter > result ? 0 : result + (uint64_t) letter;
             ptr++;
         }
         else
-            end = NULL;
+            stop = NULL;
 
         if (tmp_result) {
             result += tmp_result;
         }
+        if (result > INT_MAX) {
+            result = INT_MAX;
+        }
     }
 
-    free(s);
+    return (int) result;
+}
+
+/**
+ * Sum each part of a '.'-delimited version span
+ * @see version_sum()
+ * @param str version span
+ * @param len length of str
+ * @return sum of each part, saturated at INT_MAX
+ * @return -1 on error
+ */
+int version_sum_n(const char *str, size_t len) {
+    VERSION_STATS_START(start);
+    int result = version_sum_span(str, len);
+    VERSION_STATS_PARSE(len, result, start);
     return result;
 }
 
 /**
- * Convert version operator(s) to flags
- * @param str input string
+ * Sum each part of a '.'-delimited version string
+ *
+ * The sum is lossy ("1.0.150" and "2.0.49" collide) and is no longer used to
+ * order versions. See version_cmp(). Sums that do not fit in an int are
+ * INT_MAX, so a valid version never sums to a negative value.
+ *
+ * @param str version string
+ * @return sum of each part, saturated at INT_MAX
+ * @return -1 on error
+ */
+int version_sum(const char *str) {
+    if (!str) {
+        return -1;
+    }
+    return version_sum_n(str, strlen(str));
+}
+
+/**
+ * Convert version operator(s) in a span to flags
+ * @param str input span
+ * @param len length of str
  * @return operator flags
+ * @return -1 on error
  */
-int version_parse_operator(char *str) {
-    const char *valid = "><=!";
-    char *pos;
-    char *strp;
+int version_parse_operator_n(const char *str, size_t len) {
     int result;
 
-    strp = str;
-    pos = strp;
-    result = 0;
-
-    if (isempty(str)) {
+    if (!str || vcmp_isempty_n(str, len)) {
         return -1;
     }
-    while ((pos = strpbrk(pos, valid)) != NULL) {
-        switch (*pos) {
+
+    result = 0;
+    for (size_t i = 0; i < len; i++) {
+        switch (str[i]) {
             case '>':
                 result |= GT;
                 break;
@@ -223,8 +604,9 @@ int version_parse_operator(char *str) {
             case '!':
                 result |= NOT;
                 break;
+            default:
+                break;
         }
-        strp = pos++;
     }
 
     if (!result)
@@ -232,106 +614,4490 @@ int version_parse_operator(char *str) {
     return result;
 }
 
-int version_has_epoch(const char *str) {
-    char *result;
-    result = strchr(str, ':');
-    return result ? 1 : 0;
+/**
+ * Convert version operator(s) to flags
+ * @param str input string
+ * @return operator flags
+ */
+int version_parse_operator(char *str) {
+    if (!str) {
+        return -1;
+    }
+    return version_parse_operator_n(str, strlen(str));
 }
 
 /**
- * Compare version strings based on flag(s)
- * @param flags verison operators
- * @param aa version1
- * @param bb version2
- * @return 1 flag operation is true
- * @return 0 flag operation is false
+ * Determine whether a version string carries an epoch
+ * @param str version string
+ * @return 1 if an epoch is present
+ * @return 0 if an epoch is not present
  */
-int version_compare(int flags, const char *aa, const char *bb) {
-    int result, result_a, result_b;
+int version_has_epoch(const char *str) {
+    const char *ptr;
 
-    if (!flags || flags < 0) {
-        return -1;
+    if (!str) {
+        return 0;
     }
 
-    result_a = version_sum(aa);
-    if (result_a < 0)
-        return -1;
-
-    result_b = version_sum(bb);
-    if (result_b < 0)
-        return -1;
+    // An epoch can only be the leading digit run
+    ptr = str;
+    while (isspace((unsigned char) *ptr)) {
+        ptr++;
+    }
+    while (isdigit((unsigned char) *ptr)) {
+        ptr++;
+    }
+    return *ptr == ':';
+}
 
+/**
+ * Consume the epoch of a version string
+ * @param str version string
+ * @param end end of the span, or NULL if str is NUL-terminated
+ * @param epoch destination for the epoch (0 when not present)
+ * @param has_epoch destination for whether an epoch was present
+ * @return pointer to the first component
+ * @return NULL if the string is empty
+ */
+static const char *version_epoch(const char *str, const char *end, uint64_t *epoch, int *has_epoch) {
+    const char *ptr;
+    uint64_t value;
 
-    if ((version_has_epoch(aa) && !version_has_epoch(bb))) {
-        result_a -= EPOCH_MOD;
+    ptr = str;
+    while (isspace((unsigned char) VERSION_AT(ptr, end))) {
+        ptr++;
     }
-    if (!version_has_epoch(aa) && version_has_epoch(bb)) {
-        result_b -= EPOCH_MOD;
+    if (VERSION_AT(ptr, end) == '\0') {
+        return NULL;
     }
 
-    result = 0;
-    if (flags & GT && flags & EQ)
-        result |= result_a >= result_b;
-    else if (flags & LT && flags & EQ)
-        result |= result_a <= result_b;
-    else if (flags & NOT && flags & EQ)
-        result |= result_a != result_b;
-    else if (flags & GT)
-        result |= result_a > result_b;
-    else if (flags & LT)
-        result |= result_a < result_b;
-    else if (flags & EQ)
-        result |= result_a == result_b;
+    *epoch = 0;
+    *has_epoch = 0;
+    value = 0;
+    str = ptr;
+    while (isdigit((unsigned char) VERSION_AT(ptr, end))) {
+        unsigned digit = (unsigned) (*ptr - '0');
+        value = value > (UINT64_MAX - digit) / 10 ? UINT64_MAX : value * 10 + digit;
+        ptr++;
+    }
+    if (VERSION_AT(ptr, end) != ':') {
+        return str;
+    }
 
-    return result;
+    *epoch = value;
+    *has_epoch = 1;
+    return ptr + 1;
 }
 
-void usage(char *prog) {
-    char *name;
-    name = strrchr(prog, '/');
-    if (!name)
-        name = prog;
-    else
-        name++;
+/**
+ * Consume the next component of a version string
+ *
+ * A component is a run of digits optionally followed by a run of letters
+ * (the tag). Components are delimited by '.' or '-', or by a digit following
+ * a tag ("1a2" is "1a" and "2"). The walk stops at the first character that
+ * cannot be part of a version.
+ *
+ * @param ptr cursor into the version string, advanced past the component
+ * @param end end of the span, or NULL if the string is NUL-terminated
+ * @param value destination for the numeric part (saturates at UINT64_MAX)
+ * @param tag destination for the first VCMP_TAG_MAX letters, packed big-endian
+ * @param letters destination for the start of the tag
+ * @param nletters destination for the length of the whole tag
+ * @return 1 if a component was consumed
+ * @return 0 if there are no more components
+ */
+static int version_next(const char **ptr, const char *end, uint64_t *value, uint64_t *tag,
+                        const char **letters, size_t *nletters) {
+    const char *pos;
+    const char *start;
+    size_t taglen;
 
-    char *examples[] = {
-            "{v} execution example:\n",
-            "    %s \"1.2.3 >  1.2.3\"\n",
-            "    0\n",
-            "    %s \"1.2.3 >= 1.2.3\"\n",
-            "    1\n",
-            "    %s \"1.2.3 <  1.2.3\"\n",
-            "    0\n",
-            "    %s \"1.2.3 <= 1.2.3\"\n",
-            "    1\n",
-            "    %s \"1.2.3 != 1.2.3\"\n",
-            "    0\n",
-            "    %s \"1.2.3 =  1.2.3\"\n",
-            "    1\n",
-            "\n",
-            "{v1} {operator} {v2} execution example:\n",
-            "    %s \"1.2.3\" \">\"  \"1.2.3\"\n",
-            "    0\n",
-            "    %s \"1.2.3\" \">=\" \"1.2.3\"\n",
-            "    1\n",
-            "    %s \"1.2.3\" \"<\"  \"1.2.3\"\n",
-            "    0\n",
-            "    %s \"1.2.3\" \"<=\" \"1.2.3\"\n",
-            "    1\n",
-            "    %s \"1.2.3\" \"!=\" \"1.2.3\"\n",
-            "    0\n",
-            "    %s \"1.2.3\" \"=\"  \"1.2.3\"\n",
-            "    1\n",
-            NULL,
-    };
+    *value = 0;
+    *tag = 0;
+    *nletters = 0;
+    pos = *ptr;
+    *letters = pos;
+    if (!pos) {
+        return 0;
+    }
 
-    printf("usage: %s {{v} | {v1} {operator} {v2}}\n", name);
-    for (int i = 0; examples[i] != NULL; i++) {
-        char *output;
+    start = pos;
+    while (isdigit((unsigned char) VERSION_AT(pos, end))) {
+        unsigned digit = (unsigned) (*pos - '0');
+        *value = *value > (UINT64_MAX - digit) / 10 ? UINT64_MAX : *value * 10 + digit;
+        pos++;
+    }
 
-        output = examples[i];
-        if (strchr(examples[i], '%')) {
-            printf(output, name);
+    taglen = 0;
+    *letters = pos;
+    while (isalpha((unsigned char) VERSION_AT(pos, end))) {
+        if (taglen < VCMP_TAG_MAX) {
+            // Packed big-endian, integer order matches string order
+            *tag |= (uint64_t) (unsigned char) *pos << (8 * (VCMP_TAG_MAX - 1 - taglen));
+            taglen++;
+        }
+        pos++;
+    }
+    *nletters = (size_t) (pos - *letters);
+
+    if (VERSION_AT(pos, end) == '.' || VERSION_AT(pos, end) == '-') {
+        pos++;
+    } else if (pos == start) {
+        *ptr = NULL;
+        return 0;
+    } else if (!isdigit((unsigned char) VERSION_AT(pos, end))) {
+        pos = NULL;
+    }
+
+    *ptr = pos;
+    return 1;
+}
+
+/**
+ * Drop trailing zero components, they do not affect ordering
+ * @param version parsed version
+ */
+static void version_trim(vcmp_version *version) {
+    while (version->count
+           && !version->component[version->count - 1]
+           && !version->tag[version->count - 1]) {
+        version->count--;
+    }
+}
+
+static int version_isa = VCMP_ISA_AUTO;
+static int version_isa_auto = VCMP_ISA_SCALAR;
+static pthread_once_t version_isa_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Pick the best instruction set of this CPU, once per process
+ */
+static void version_isa_init(void) {
+#if defined(VCMP_HAVE_X86_SIMD)
+    version_isa_auto = __builtin_cpu_supports("avx2") ? VCMP_ISA_AVX2
+                     : __builtin_cpu_supports("sse2") ? VCMP_ISA_SSE2 : VCMP_ISA_SCALAR;
+#endif
+}
+
+/**
+ * Select the instruction set used by the version tokenizer
+ *
+ * Meant for testing and benchmarking. This is not synchronized, so call it
+ * before any other thread uses the library.
+ *
+ * @param isa one of VCMP_ISA_*
+ * @return 0 on success
+ * @return -1 if the instruction set is not supported by this CPU or build
+ */
+int version_set_isa(int isa) {
+    switch (isa) {
+        case VCMP_ISA_AUTO:
+        case VCMP_ISA_SCALAR:
+            break;
+#if defined(VCMP_HAVE_X86_SIMD)
+        case VCMP_ISA_SSE2:
+            if (!__builtin_cpu_supports("sse2")) {
+                return -1;
+            }
+            break;
+        case VCMP_ISA_AVX2:
+            if (!__builtin_cpu_supports("avx2")) {
+                return -1;
+            }
+            break;
+#endif
+        default:
+            return -1;
+    }
+    version_isa = isa;
+    return 0;
+}
+
+/**
+ * Resolve the instruction set selected by version_set_isa()
+ *
+ * CPU detection runs once, callers resolve once per call rather than per
+ * block of input.
+ *
+ * @return one of VCMP_ISA_* other than VCMP_ISA_AUTO
+ */
+static int version_isa_current(void) {
+    int isa = version_isa;
+
+    if (isa == VCMP_ISA_AUTO) {
+        pthread_once(&version_isa_once, version_isa_init);
+        isa = version_isa_auto;
+    }
+    return isa;
+}
+
+/**
+ * Classify bytes as digits or letters
+ * @param str input
+ * @param len number of bytes to classify (64 at most)
+ * @param digit destination bitmask of digits, bit i is str[i]
+ * @param alpha destination bitmask of letters, bit i is str[i]
+ */
+static void version_classify_scalar(const char *str, size_t len, uint64_t *digit, uint64_t *alpha) {
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char) str[i];
+        if ((unsigned char) (c - '0') < 10) {
+            *digit |= (uint64_t) 1 << i;
+        } else if ((unsigned char) ((c | 0x20) - 'a') < 26) {
+            *alpha |= (uint64_t) 1 << i;
+        }
+    }
+}
+
+#if defined(VCMP_HAVE_X86_SIMD)
+__attribute__((target("sse2")))
+static void version_classify_sse2(const char *str, size_t len, uint64_t *digit, uint64_t *alpha) {
+    const __m128i zero = _mm_set1_epi8('0' - 1);
+    const __m128i nine = _mm_set1_epi8('9' + 1);
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i a = _mm_set1_epi8('a' - 1);
+    const __m128i z = _mm_set1_epi8('z' + 1);
+    size_t i;
+
+    // Bytes >= 0x80 compare as negative and fall outside both ranges
+    for (i = 0; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *) (str + i));
+        __m128i folded = _mm_or_si128(block, lower);
+        __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(block, zero), _mm_cmplt_epi8(block, nine));
+        __m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(folded, a), _mm_cmplt_epi8(folded, z));
+        *digit |= (uint64_t) (unsigned) _mm_movemask_epi8(is_digit) << i;
+        *alpha |= (uint64_t) (unsigned) _mm_movemask_epi8(is_alpha) << i;
+    }
+    if (i < len) {
+        uint64_t tail_digit = 0, tail_alpha = 0;
+        version_classify_scalar(str + i, len - i, &tail_digit, &tail_alpha);
+        *digit |= tail_digit << i;
+        *alpha |= tail_alpha << i;
+    }
+}
+
+__attribute__((target("avx2")))
+static void version_classify_avx2(const char *str, size_t len, uint64_t *digit, uint64_t *alpha) {
+    const __m256i zero = _mm256_set1_epi8('0' - 1);
+    const __m256i nine = _mm256_set1_epi8('9' + 1);
+    const __m256i lower = _mm256_set1_epi8(0x20);
+    const __m256i a = _mm256_set1_epi8('a' - 1);
+    const __m256i z = _mm256_set1_epi8('z' + 1);
+    size_t i;
+
+    for (i = 0; i + 32 <= len; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *) (str + i));
+        __m256i folded = _mm256_or_si256(block, lower);
+        __m256i is_digit = _mm256_and_si256(_mm256_cmpgt_epi8(block, zero), _mm256_cmpgt_epi8(nine, block));
+        __m256i is_alpha = _mm256_and_si256(_mm256_cmpgt_epi8(folded, a), _mm256_cmpgt_epi8(z, folded));
+        *digit |= (uint64_t) (uint32_t) _mm256_movemask_epi8(is_digit) << i;
+        *alpha |= (uint64_t) (uint32_t) _mm256_movemask_epi8(is_alpha) << i;
+    }
+    if (i < len) {
+        uint64_t tail_digit = 0, tail_alpha = 0;
+        version_classify_sse2(str + i, len - i, &tail_digit, &tail_alpha);
+        *digit |= tail_digit << i;
+        *alpha |= tail_alpha << i;
+    }
+}
+#endif
+
+struct version_scan {
+    const char *str;
+    size_t len;
+    size_t base;
+    uint64_t digit;
+    uint64_t alpha;
+    int isa;
+};
+
+/**
+ * Classify the 64-byte window of a string that starts at base
+ * @param scan tokenizer state
+ * @param base window offset, a multiple of 64
+ */
+static void version_scan_load(struct version_scan *scan, size_t base) {
+    const char *str = scan->str + base;
+    size_t len = scan->len - base < 64 ? scan->len - base : 64;
+    int isa = scan->isa;
+
+    scan->base = base;
+    scan->digit = 0;
+    scan->alpha = 0;
+#if defined(VCMP_HAVE_X86_SIMD)
+    if (isa == VCMP_ISA_AVX2) {
+        version_classify_avx2(str, len, &scan->digit, &scan->alpha);
+        return;
+    }
+    if (isa == VCMP_ISA_SSE2) {
+        version_classify_sse2(str, len, &scan->digit, &scan->alpha);
+        return;
+    }
+#endif
+    (void) isa;
+    version_classify_scalar(str, len, &scan->digit, &scan->alpha);
+}
+
+/**
+ * Find the end of a run of digits or letters
+ * @param scan tokenizer state
+ * @param pos start of the run
+ * @param alpha non-zero for a run of letters, zero for a run of digits
+ * @return offset of the first byte after the run
+ */
+static size_t version_scan_run(struct version_scan *scan, size_t pos, int alpha) {
+    while (pos < scan->len) {
+        size_t base = pos & ~(size_t) 63;
+        uint64_t rest;
+
+        if (base != scan->base) {
+            version_scan_load(scan, base);
+        }
+
+        rest = ~((alpha ? scan->alpha : scan->digit) >> (pos - base));
+        if (!rest) {
+            pos = base + 64;
+            continue;
+        }
+#if defined(__GNUC__)
+        pos += (size_t) __builtin_ctzll(rest);
+#else
+        while (!(rest & 1)) {
+            rest >>= 1;
+            pos++;
+        }
+#endif
+        if (pos < base + 64) {
+            break;
+        }
+    }
+    return pos < scan->len ? pos : scan->len;
+}
+
+/**
+ * Convert a run of digits to an integer
+ * @param str digits
+ * @param len number of digits
+ * @return value (saturates at UINT64_MAX)
+ */
+static uint64_t version_digits(const char *str, size_t len) {
+    uint64_t value = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        unsigned digit = (unsigned) (str[i] - '0');
+        value = value > (UINT64_MAX - digit) / 10 ? UINT64_MAX : value * 10 + digit;
+    }
+    return value;
+}
+
+/**
+ * Pack the first VCMP_TAG_MAX letters of a run big-endian
+ * @param str letters
+ * @param len number of letters
+ * @return packed tag
+ */
+static uint64_t version_tag(const char *str, size_t len) {
+    uint64_t tag = 0;
+
+    for (size_t i = 0; i < len && i < VCMP_TAG_MAX; i++) {
+        tag |= (uint64_t) (unsigned char) str[i] << (8 * (VCMP_TAG_MAX - 1 - i));
+    }
+    return tag;
+}
+
+/**
+ * Parse a version span without counting it
+ * @see version_parse_n()
+ */
+static int version_parse_span(const char *str, size_t len, vcmp_version *version) {
+    struct version_scan scan;
+    const char *ptr;
+    size_t pos, end;
+
+    if (!str || !version) {
+        return -1;
+    }
+
+    memset(version, 0, sizeof(*version));
+    ptr = str;
+    while (len && isspace((unsigned char) *ptr)) {
+        ptr++;
+        len--;
+    }
+
+    scan.str = ptr;
+    scan.len = len;
+    scan.base = SIZE_MAX;
+    if (!scan.len || !*ptr) {
+        return -1;
+    }
+    scan.isa = version_isa_current();
+
+    pos = 0;
+    end = version_scan_run(&scan, pos, 0);
+    if (end < scan.len && ptr[end] == ':') {
+        version->epoch = version_digits(ptr, end);
+        version->has_epoch = 1;
+        pos = end + 1;
+    }
+
+    while (1) {
+        size_t start = pos;
+        uint64_t value, tag;
+        int last;
+
+        end = version_scan_run(&scan, pos, 0);
+        value = version_digits(ptr + pos, end - pos);
+        pos = end;
+        end = version_scan_run(&scan, pos, 1);
+        if (end - pos > VCMP_TAG_MAX) {
+            return -1;
+        }
+        tag = version_tag(ptr + pos, end - pos);
+        pos = end;
+
+        last = 0;
+        if (pos < scan.len && (ptr[pos] == '.' || ptr[pos] == '-')) {
+            pos++;
+        } else if (pos == start) {
+            break;
+        } else if (pos == scan.len || !isdigit((unsigned char) ptr[pos])) {
+            last = 1;
+        }
+
+        if (version->count == VCMP_COMPONENTS_MAX) {
+            return -1;
+        }
+        version->component[version->count] = value;
+        version->tag[version->count] = tag;
+        version->count++;
+        if (last) {
+            break;
+        }
+    }
+
+    version_trim(version);
+    return 0;
+}
+
+/**
+ * Parse a version string into its components
+ *
+ * See version_next() for what makes up a component. A leading "N:" is
+ * recorded as the epoch. Trailing zero components are dropped, so "1.0" and
+ * "1" parse to the same value. Tags longer than VCMP_TAG_MAX letters do not
+ * fit the packed form and are rejected, version_cmp() compares them in full.
+ *
+ * Digit and letter runs are located with bitmasks computed 64 bytes at a
+ * time (SSE2 or AVX2 when the CPU supports them), so long versions are not
+ * walked byte by byte.
+ *
+ * @param str version span
+ * @param len length of str
+ * @param version destination
+ * @return 0 on success
+ * @return -1 on error, or when there are more than VCMP_COMPONENTS_MAX components
+ * or a tag longer than VCMP_TAG_MAX letters
+ */
+int version_parse_n(const char *str, size_t len, vcmp_version *version) {
+    VERSION_STATS_START(start);
+    int result = version_parse_span(str, len, version);
+    VERSION_STATS_PARSE(len, result, start);
+    return result;
+}
+
+/**
+ * Parse a version string into its components
+ * @see version_parse_n()
+ * @param str version string
+ * @param version destination
+ * @return 0 on success
+ * @return -1 on error, or when there are more than VCMP_COMPONENTS_MAX components
+ * or a tag longer than VCMP_TAG_MAX letters
+ */
+int version_parse(const char *str, vcmp_version *version) {
+    if (!str) {
+        return -1;
+    }
+    return version_parse_n(str, strlen(str), version);
+}
+
+/**
+ * Parse a version string one byte at a time
+ *
+ * Reference implementation of version_parse(), used to verify the
+ * vectorized tokenizer.
+ *
+ * @param str version string
+ * @param version destination
+ * @return 0 on success
+ * @return -1 on error, or when there are more than VCMP_COMPONENTS_MAX components
+ * or a tag longer than VCMP_TAG_MAX letters
+ */
+int version_parse_scalar(const char *str, vcmp_version *version) {
+    const char *ptr, *letters;
+    uint64_t value, tag;
+    size_t nletters;
+    int has_epoch;
+
+    if (!str || !version) {
+        return -1;
+    }
+
+    memset(version, 0, sizeof(*version));
+    ptr = version_epoch(str, NULL, &version->epoch, &has_epoch);
+    if (!ptr) {
+        return -1;
+    }
+    version->has_epoch = (unsigned char) has_epoch;
+
+    while (version_next(&ptr, NULL, &value, &tag, &letters, &nletters)) {
+        if (version->count == VCMP_COMPONENTS_MAX || nletters > VCMP_TAG_MAX) {
+            return -1;
+        }
+        version->component[version->count] = value;
+        version->tag[version->count] = tag;
+        version->count++;
+    }
+
+    version_trim(version);
+    return 0;
+}
+
+/**
+ * Order two components
+ * @return -1, 0 or 1
+ */
+static int version_cmp_component(uint64_t value_a, uint64_t tag_a, uint64_t value_b, uint64_t tag_b) {
+    if (value_a != value_b) {
+        return value_a < value_b ? -1 : 1;
+    }
+    if (tag_a != tag_b) {
+        return tag_a < tag_b ? -1 : 1;
+    }
+    return 0;
+}
+
+/**
+ * Order the letters of two tags past their packed VCMP_TAG_MAX prefix
+ * @return -1, 0 or 1
+ */
+static int version_cmp_letters(const char *a, size_t len_a, const char *b, size_t len_b) {
+    int result = memcmp(a, b, len_a < len_b ? len_a : len_b);
+
+    if (result) {
+        return result < 0 ? -1 : 1;
+    }
+    return (len_a > len_b) - (len_a < len_b);
+}
+
+/**
+ * Three-way comparison of parsed versions
+ *
+ * Epochs are compared first (a missing epoch is 0), then components from
+ * left to right. A missing component is 0, and a tagged component is
+ * greater than the same number without a tag ("1.0a" > "1.0").
+ *
+ * @param a version1
+ * @param b version2
+ * @return -1 if a < b
+ * @return 0 if a == b
+ * @return 1 if a > b
+ * @return VCMP_CMP_ERROR on error
+ */
+int version_cmp_parsed(const vcmp_version *a, const vcmp_version *b) {
+    size_t count;
+
+    if (!a || !b) {
+        return VCMP_CMP_ERROR;
+    }
+
+    if (a->epoch != b->epoch) {
+        return a->epoch < b->epoch ? -1 : 1;
+    }
+
+    // Unused slots are zeroed by version_parse()
+    count = a->count > b->count ? a->count : b->count;
+    for (size_t i = 0; i < count; i++) {
+        int result = version_cmp_component(a->component[i], a->tag[i], b->component[i], b->tag[i]);
+        if (result) {
+            return result;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Walk two version spans in lockstep
+ *
+ * Components are only compared up to the first difference. The rest is
+ * scanned to apply the VCMP_COMPONENTS_MAX limit that version_parse()
+ * applies, so both accept the same versions.
+ *
+ * @param last_a version1, advanced to the end of the last component scanned
+ * @param end_a end of version1, or NULL if it is NUL-terminated
+ * @param last_b version2, advanced to the end of the last component scanned
+ * @param end_b end of version2, or NULL if it is NUL-terminated
+ * @return -1, 0, 1 or VCMP_CMP_ERROR
+ */
+static int version_cmp_walk(const char **last_a, const char *end_a, const char **last_b, const char *end_b) {
+    const char *ptr_a, *ptr_b;
+    uint64_t epoch_a, epoch_b;
+    int has_epoch, result;
+
+    ptr_a = version_epoch(*last_a, end_a, &epoch_a, &has_epoch);
+    ptr_b = version_epoch(*last_b, end_b, &epoch_b, &has_epoch);
+    if (!ptr_a || !ptr_b) {
+        return VCMP_CMP_ERROR;
+    }
+
+    result = 0;
+    if (epoch_a != epoch_b) {
+        result = epoch_a < epoch_b ? -1 : 1;
+    }
+
+    for (size_t count = 1;; count++) {
+        uint64_t value_a, tag_a, value_b, tag_b;
+        const char *letters_a, *letters_b;
+        size_t nletters_a, nletters_b;
+        int more_a, more_b;
+
+        more_a = version_next(&ptr_a, end_a, &value_a, &tag_a, &letters_a, &nletters_a);
+        more_b = version_next(&ptr_b, end_b, &value_b, &tag_b, &letters_b, &nletters_b);
+        if (!more_a && !more_b) {
+            return result;
+        }
+        if (more_a) {
+            *last_a = letters_a + nletters_a;
+        }
+        if (more_b) {
+            *last_b = letters_b + nletters_b;
+        }
+        if (count > VCMP_COMPONENTS_MAX) {
+            return VCMP_CMP_ERROR;
+        }
+        if (result) {
+            continue;
+        }
+
+        result = version_cmp_component(value_a, tag_a, value_b, tag_b);
+        // Equal packed prefixes of a longer tag mean both have at least
+        // VCMP_TAG_MAX letters
+        if (!result && (nletters_a > VCMP_TAG_MAX || nletters_b > VCMP_TAG_MAX)) {
+            result = version_cmp_letters(letters_a + VCMP_TAG_MAX, nletters_a - VCMP_TAG_MAX,
+                                         letters_b + VCMP_TAG_MAX, nletters_b - VCMP_TAG_MAX);
+        }
+    }
+}
+
+/**
+ * Three-way comparison of version spans
+ *
+ * Same ordering as version_cmp_parsed(). Counted as two parses, the
+ * comparison itself is counted by the callers that apply flags.
+ *
+ * @param aa version1, or NULL
+ * @param end_a end of aa, or NULL if aa is NUL-terminated
+ * @param bb version2
+ * @param end_b end of bb, or NULL if bb is NUL-terminated
+ * @return -1, 0, 1 or VCMP_CMP_ERROR
+ */
+static int version_cmp_span(const char *aa, const char *end_a, const char *bb, const char *end_b) {
+    VERSION_STATS_START(start);
+    const char *last_a = aa, *last_b = bb;
+    int result;
+
+    if (!aa || !bb) {
+        return VCMP_CMP_ERROR;
+    }
+    result = version_cmp_walk(&last_a, end_a, &last_b, end_b);
+    VERSION_STATS_WALK((size_t) (last_a - aa) + (size_t) (last_b - bb), result, start);
+    return result;
+}
+
+/**
+ * Three-way comparison of version strings
+ *
+ * Same ordering as version_cmp_parsed(), but the strings are walked in
+ * lockstep without parsing them into a vcmp_version. Versions with more than
+ * VCMP_COMPONENTS_MAX components are rejected, as by version_parse().
+ *
+ * @param aa version1
+ * @param bb version2
+ * @return -1 if aa < bb
+ * @return 0 if aa == bb
+ * @return 1 if aa > bb
+ * @return VCMP_CMP_ERROR on error
+ */
+int version_cmp(const char *aa, const char *bb) {
+    return version_cmp_span(aa, NULL, bb, NULL);
+}
+
+/**
+ * Three-way comparison of version spans
+ * @see version_cmp()
+ * @param aa version1
+ * @param len_a length of aa
+ * @param bb version2
+ * @param len_b length of bb
+ * @return -1 if aa < bb
+ * @return 0 if aa == bb
+ * @return 1 if aa > bb
+ * @return VCMP_CMP_ERROR on error
+ */
+int version_cmp_n(const char *aa, size_t len_a, const char *bb, size_t len_b) {
+    if (!aa || !bb) {
+        return VCMP_CMP_ERROR;
+    }
+    return version_cmp_span(aa, aa + len_a, bb, bb + len_b);
+}
+
+/**
+ * Apply version operator flag(s) to a three-way comparison result
+ * @param flags version operators
+ * @param cmp result of version_cmp() or version_cmp_parsed()
+ * @return 1 flag operation is true
+ * @return 0 flag operation is false
+ * @return -1 on error
+ */
+int version_compare_result(int flags, int cmp) {
+    int result;
+
+    if (!flags || flags < 0 || cmp == VCMP_CMP_ERROR) {
+        return -1;
+    }
+
+    result = 0;
+    if (flags & GT && flags & EQ)
+        result |= cmp >= 0;
+    else if (flags & LT && flags & EQ)
+        result |= cmp <= 0;
+    else if (flags & NOT && flags & EQ)
+        result |= cmp != 0;
+    else if (flags & GT)
+        result |= cmp > 0;
+    else if (flags & LT)
+        result |= cmp < 0;
+    else if (flags & EQ)
+        result |= cmp == 0;
+
+    return result;
+}
+
+/**
+ * Compare parsed versions based on flag(s)
+ * @param flags version operators
+ * @param a version1
+ * @param b version2
+ * @return 1 flag operation is true
+ * @return 0 flag operation is false
+ * @return -1 on error
+ */
+int version_compare_parsed(int flags, const vcmp_version *a, const vcmp_version *b) {
+    VERSION_STATS_START(start);
+    int result = -1;
+
+    if (flags > 0) {
+        result = version_compare_result(flags, version_cmp_parsed(a, b));
+    }
+    VERSION_STATS_COMPARE(flags, result, start);
+    return result;
+}
+
+struct version_cache_entry {
+    uint64_t hash;
+    char a[VCMP_CACHE_STRING_MAX];
+    char b[VCMP_CACHE_STRING_MAX];
+    unsigned char len_a;
+    unsigned char len_b;
+    signed char cmp;
+    unsigned char used;
+    unsigned char referenced;
+};
+
+static struct {
+    pthread_mutex_t lock;
+    struct version_cache_entry *entry;
+    unsigned char *hand;
+    size_t nsets;
+    vcmp_cache_stats stats;
+} version_cache = {PTHREAD_MUTEX_INITIALIZER, NULL, NULL, 0, {0, 0, 0, 0, 0}};
+
+/**
+ * Enable the comparison cache
+ *
+ * version_compare() and version_compare_n() remember the ordering of version
+ * pairs whose strings are at most VCMP_CACHE_STRING_MAX bytes (after
+ * stripping whitespace). Longer pairs bypass the cache. Entries are grouped
+ * in sets of VCMP_CACHE_WAYS and evicted with the CLOCK algorithm within a
+ * set.
+ *
+ * Lookups are serialized by a mutex, but enabling and disabling the cache is
+ * not. Call this before any other thread uses the library.
+ *
+ * @param entries capacity, rounded up to a power of two
+ * @return 0 on success
+ * @return -1 on error
+ */
+int version_cache_init(size_t entries) {
+    size_t nsets;
+
+    if (!entries || entries > SIZE_MAX / 2 / sizeof(struct version_cache_entry)) {
+        return -1;
+    }
+
+    nsets = 1;
+    while (nsets * VCMP_CACHE_WAYS < entries) {
+        nsets <<= 1;
+    }
+
+    version_cache_free();
+    version_cache.entry = calloc(nsets * VCMP_CACHE_WAYS, sizeof(*version_cache.entry));
+    version_cache.hand = calloc(nsets, sizeof(*version_cache.hand));
+    if (!version_cache.entry || !version_cache.hand) {
+        version_cache_free();
+        return -1;
+    }
+    version_cache.nsets = nsets;
+    memset(&version_cache.stats, 0, sizeof(version_cache.stats));
+    version_cache.stats.capacity = nsets * VCMP_CACHE_WAYS;
+    return 0;
+}
+
+/**
+ * Disable the comparison cache and release its memory
+ */
+void version_cache_free(void) {
+    free(version_cache.entry);
+    free(version_cache.hand);
+    version_cache.entry = NULL;
+    version_cache.hand = NULL;
+    version_cache.nsets = 0;
+    version_cache.stats.capacity = 0;
+    version_cache.stats.entries = 0;
+}
+
+/**
+ * Read the comparison cache counters
+ * @param stats destination
+ */
+void version_cache_stats(vcmp_cache_stats *stats) {
+    pthread_mutex_lock(&version_cache.lock);
+    *stats = version_cache.stats;
+    pthread_mutex_unlock(&version_cache.lock);
+}
+
+/**
+ * Hash a version pair (FNV-1a)
+ * @return hash
+ */
+static uint64_t version_cache_hash(const char *a, size_t len_a, const char *b, size_t len_b) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; i < len_a; i++) {
+        hash ^= (unsigned char) a[i];
+        hash *= 0x100000001b3ULL;
+    }
+    // Keep ("1.2", "3") and ("1.", "23") apart
+    hash ^= 0xff;
+    hash *= 0x100000001b3ULL;
+    for (size_t i = 0; i < len_b; i++) {
+        hash ^= (unsigned char) b[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * Find a version pair in the cache
+ *
+ * Must be called with the cache locked.
+ *
+ * @param hash version_cache_hash() of the pair
+ * @return entry holding the pair
+ * @return NULL if the pair is not cached
+ */
+static struct version_cache_entry *version_cache_find(const char *a, size_t len_a, const char *b, size_t len_b,
+                                                      uint64_t hash) {
+    struct version_cache_entry *set;
+
+    set = &version_cache.entry[((size_t) (hash >> 32 ^ hash) & (version_cache.nsets - 1)) * VCMP_CACHE_WAYS];
+    for (size_t i = 0; i < VCMP_CACHE_WAYS; i++) {
+        struct version_cache_entry *entry = &set[i];
+        if (entry->used && entry->hash == hash && entry->len_a == len_a && entry->len_b == len_b
+            && !memcmp(entry->a, a, len_a) && !memcmp(entry->b, b, len_b)) {
+            entry->referenced = 1;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Store a version pair's ordering, evicting an entry of its set if needed
+ *
+ * Must be called with the cache locked.
+ *
+ * @param hash version_cache_hash() of the pair
+ * @param cmp ordering of the pair
+ */
+static void version_cache_store(const char *a, size_t len_a, const char *b, size_t len_b, uint64_t hash, int cmp) {
+    struct version_cache_entry *set, *entry;
+    size_t index;
+
+    if (version_cache_find(a, len_a, b, len_b, hash)) {
+        return;
+    }
+
+    // CLOCK: skip (and clear) recently referenced entries
+    index = (size_t) (hash >> 32 ^ hash) & (version_cache.nsets - 1);
+    set = &version_cache.entry[index * VCMP_CACHE_WAYS];
+    while (1) {
+        entry = &set[version_cache.hand[index]];
+        version_cache.hand[index] = (unsigned char) ((version_cache.hand[index] + 1) % VCMP_CACHE_WAYS);
+        if (!entry->used || !entry->referenced) {
+            break;
+        }
+        entry->referenced = 0;
+    }
+
+    if (entry->used) {
+        version_cache.stats.evictions++;
+    } else {
+        version_cache.stats.entries++;
+    }
+    entry->hash = hash;
+    memcpy(entry->a, a, len_a);
+    memcpy(entry->b, b, len_b);
+    entry->len_a = (unsigned char) len_a;
+    entry->len_b = (unsigned char) len_b;
+    entry->cmp = (signed char) cmp;
+    entry->used = 1;
+    entry->referenced = 0;
+}
+
+/**
+ * Three-way comparison of version spans through the cache
+ * @see version_cmp_n()
+ * @return -1, 0, 1 or VCMP_CMP_ERROR
+ */
+static int version_cache_cmp(const char *aa, size_t len_a, const char *bb, size_t len_b) {
+    struct version_cache_entry *entry;
+    uint64_t hash;
+    int result;
+
+    if (!aa || !bb) {
+        return VCMP_CMP_ERROR;
+    }
+
+    aa = vcmp_lstrip_n(aa, &len_a);
+    len_a = vcmp_rstrip_n(aa, len_a);
+    bb = vcmp_lstrip_n(bb, &len_b);
+    len_b = vcmp_rstrip_n(bb, len_b);
+    if (len_a > VCMP_CACHE_STRING_MAX || len_b > VCMP_CACHE_STRING_MAX) {
+        return version_cmp_n(aa, len_a, bb, len_b);
+    }
+
+    hash = version_cache_hash(aa, len_a, bb, len_b);
+    pthread_mutex_lock(&version_cache.lock);
+    entry = version_cache_find(aa, len_a, bb, len_b, hash);
+    if (entry) {
+        version_cache.stats.hits++;
+        result = entry->cmp;
+        pthread_mutex_unlock(&version_cache.lock);
+        return result;
+    }
+    version_cache.stats.misses++;
+    pthread_mutex_unlock(&version_cache.lock);
+
+    // Compare without holding the lock, another thread may store the pair
+    // in the meantime
+    result = version_cmp_n(aa, len_a, bb, len_b);
+
+    pthread_mutex_lock(&version_cache.lock);
+    version_cache_store(aa, len_a, bb, len_b, hash, result);
+    pthread_mutex_unlock(&version_cache.lock);
+    return result;
+}
+
+/**
+ * Load cached comparisons from a file written by version_cache_save()
+ *
+ * Loaded pairs count as neither hits nor misses. A missing file is not an
+ * error.
+ *
+ * @param path cache file
+ * @return 0 on success
+ * @return -1 on error, or if the file is not a cache file
+ */
+int version_cache_load(const char *path) {
+    char magic[sizeof(VCMP_CACHE_MAGIC)];
+    FILE *fp;
+    int result;
+
+    if (!version_cache.entry) {
+        return -1;
+    }
+
+    fp = fopen(path, "rb");
+    if (!fp) {
+        return 0;
+    }
+
+    result = 0;
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) || memcmp(magic, VCMP_CACHE_MAGIC, sizeof(magic))) {
+        result = -1;
+    }
+    pthread_mutex_lock(&version_cache.lock);
+    while (!result) {
+        struct version_cache_entry record;
+        unsigned char header[3];
+
+        if (fread(header, 1, sizeof(header), fp) != sizeof(header)) {
+            break;
+        }
+        record.len_a = header[0];
+        record.len_b = header[1];
+        record.cmp = (signed char) header[2];
+        if (record.len_a > VCMP_CACHE_STRING_MAX || record.len_b > VCMP_CACHE_STRING_MAX
+            || record.cmp < VCMP_CMP_ERROR || record.cmp > 1
+            || fread(record.a, 1, record.len_a, fp) != record.len_a
+            || fread(record.b, 1, record.len_b, fp) != record.len_b) {
+            result = -1;
+            break;
+        }
+
+        record.hash = version_cache_hash(record.a, record.len_a, record.b, record.len_b);
+        version_cache_store(record.a, record.len_a, record.b, record.len_b, record.hash, record.cmp);
+    }
+    pthread_mutex_unlock(&version_cache.lock);
+
+    fclose(fp);
+    return result;
+}
+
+/**
+ * Write the cached comparisons to a file
+ *
+ * The file is written next to path and renamed over it, so concurrent
+ * readers see either the old or the new cache.
+ *
+ * @param path cache file
+ * @return 0 on success
+ * @return -1 on error
+ */
+int version_cache_save(const char *path) {
+    char *tmp;
+    size_t len;
+    FILE *fp;
+    int result;
+
+    if (!version_cache.entry) {
+        return -1;
+    }
+
+    len = strlen(path) + 32;
+    tmp = malloc(len);
+    if (!tmp) {
+        return -1;
+    }
+    snprintf(tmp, len, "%s.%ld.tmp", path, (long) getpid());
+
+    fp = fopen(tmp, "wb");
+    if (!fp) {
+        free(tmp);
+        return -1;
+    }
+
+    result = 0;
+    if (fwrite(VCMP_CACHE_MAGIC, 1, sizeof(VCMP_CACHE_MAGIC), fp) != sizeof(VCMP_CACHE_MAGIC)) {
+        result = -1;
+    }
+    pthread_mutex_lock(&version_cache.lock);
+    for (size_t i = 0; !result && i < version_cache.nsets * VCMP_CACHE_WAYS; i++) {
+        struct version_cache_entry *entry = &version_cache.entry[i];
+        unsigned char header[3];
+
+        if (!entry->used) {
+            continue;
+        }
+        header[0] = entry->len_a;
+        header[1] = entry->len_b;
+        header[2] = (unsigned char) entry->cmp;
+        if (fwrite(header, 1, sizeof(header), fp) != sizeof(header)
+            || fwrite(entry->a, 1, entry->len_a, fp) != entry->len_a
+            || fwrite(entry->b, 1, entry->len_b, fp) != entry->len_b) {
+            result = -1;
+        }
+    }
+    pthread_mutex_unlock(&version_cache.lock);
+
+    if (fclose(fp) || result || rename(tmp, path)) {
+        remove(tmp);
+        result = -1;
+    }
+    free(tmp);
+    return result;
+}
+
+/**
+ * Compare version strings based on flag(s)
+ * @param flags verison operators
+ * @param aa version1
+ * @param bb version2
+ * @return 1 flag operation is true
+ * @return 0 flag operation is false
+ * @return -1 on error
+ */
+int version_compare(int flags, const char *aa, const char *bb) {
+    VERSION_STATS_START(start);
+    int result = -1;
+
+    if (flags > 0) {
+        if (version_cache.entry && aa && bb) {
+            result = version_compare_result(flags, version_cache_cmp(aa, strlen(aa), bb, strlen(bb)));
+        } else {
+            result = version_compare_result(flags, version_cmp(aa, bb));
+        }
+    }
+    VERSION_STATS_COMPARE(flags, result, start);
+    return result;
+}
+
+/**
+ * Compare version spans based on flag(s)
+ * @param flags version operators
+ * @param aa version1
+ * @param len_a length of aa
+ * @param bb version2
+ * @param len_b length of bb
+ * @return 1 flag operation is true
+ * @return 0 flag operation is false
+ * @return -1 on error
+ */
+int version_compare_n(int flags, const char *aa, size_t len_a, const char *bb, size_t len_b) {
+    VERSION_STATS_START(start);
+    int result = -1;
+
+    if (flags > 0) {
+        if (version_cache.entry) {
+            result = version_compare_result(flags, version_cache_cmp(aa, len_a, bb, len_b));
+        } else {
+            result = version_compare_result(flags, version_cmp_n(aa, len_a, bb, len_b));
+        }
+    }
+    VERSION_STATS_COMPARE(flags, result, start);
+    return result;
+}
+
+/**
+ * Look up an ordering scheme by name
+ * @param name "default", "semver", "pep440", "debian" or "rpm"
+ * @return one of VCMP_SCHEME_*
+ * @return -1 if the name is unknown
+ */
+int version_parse_scheme(const char *name) {
+    static const char *names[] = {
+        [VCMP_SCHEME_DEFAULT] = "default",
+        [VCMP_SCHEME_SEMVER] = "semver",
+        [VCMP_SCHEME_PEP440] = "pep440",
+        [VCMP_SCHEME_DEBIAN] = "debian",
+        [VCMP_SCHEME_RPM] = "rpm",
+    };
+
+    if (!name) {
+        return -1;
+    }
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (!strcasecmp(name, names[i])) {
+            return (int) i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Compare runs of digits as arbitrarily large numbers
+ * @param a digits
+ * @param len_a length of a (0 is zero)
+ * @param b digits
+ * @param len_b length of b (0 is zero)
+ * @return -1, 0 or 1
+ */
+static int version_digits_cmp(const char *a, size_t len_a, const char *b, size_t len_b) {
+    int result;
+
+    while (len_a && *a == '0') {
+        a++;
+        len_a--;
+    }
+    while (len_b && *b == '0') {
+        b++;
+        len_b--;
+    }
+    if (len_a != len_b) {
+        return len_a < len_b ? -1 : 1;
+    }
+    result = len_a ? memcmp(a, b, len_a) : 0;
+    return (result > 0) - (result < 0);
+}
+
+/**
+ * Measure a run of digits
+ * @param p start of the run
+ * @param end end of the span
+ * @return number of digits
+ */
+static size_t version_digits_len(const char *p, const char *end) {
+    const char *start = p;
+
+    while (p < end && isdigit((unsigned char) *p)) {
+        p++;
+    }
+    return (size_t) (p - start);
+}
+
+/**
+ * Match a keyword at the start of a span, ignoring case
+ * @param p start of the span
+ * @param end end of the span
+ * @param word lowercase keyword
+ * @return length of the keyword if it matched
+ * @return 0 if it did not
+ */
+static size_t version_keyword(const char *p, const char *end, const char *word) {
+    size_t len = strlen(word);
+
+    if ((size_t) (end - p) < len || strncasecmp(p, word, len)) {
+        return 0;
+    }
+    return len;
+}
+
+struct version_semver {
+    const char *core[3];
+    size_t core_len[3];
+    const char *pre;
+    const char *pre_end;
+};
+
+/**
+ * Check a dot-separated list of SemVer identifiers
+ * @param p start of the list
+ * @param end end of the list
+ * @param numeric_zeros non-zero to reject numeric identifiers with leading zeros
+ * @return 0 on success
+ * @return -1 on error
+ */
+static int version_semver_identifiers(const char *p, const char *end, int numeric_zeros) {
+    while (1) {
+        const char *start = p;
+        int numeric = 1;
+
+        while (p < end && *p != '.') {
+            if (!isalnum((unsigned char) *p) && *p != '-') {
+                return -1;
+            }
+            numeric &= isdigit((unsigned char) *p) != 0;
+            p++;
+        }
+        if (p == start || (numeric_zeros && numeric && *start == '0' && p - start > 1)) {
+            return -1;
+        }
+        if (p == end) {
+            return 0;
+        }
+        p++;
+    }
+}
+
+/**
+ * Parse a SemVer 2.0 version: MAJOR.MINOR.PATCH[-PRERELEASE][+BUILD]
+ *
+ * A leading 'v' is accepted.
+ *
+ * @param p start of the version
+ * @param end end of the version
+ * @param version destination
+ * @return 0 on success
+ * @return -1 on error
+ */
+static int version_semver_parse(const char *p, const char *end, struct version_semver *version) {
+    const char *build;
+
+    if (p < end && (*p == 'v' || *p == 'V')) {
+        p++;
+    }
+    for (int i = 0; i < 3; i++) {
+        if (i && (p == end || *p++ != '.')) {
+            return -1;
+        }
+        version->core[i] = p;
+        version->core_len[i] = version_digits_len(p, end);
+        if (!version->core_len[i] || (*p == '0' && version->core_len[i] > 1)) {
+            return -1;
+        }
+        p += version->core_len[i];
+    }
+
+    version->pre = NULL;
+    version->pre_end = NULL;
+    build = memchr(p, '+', (size_t) (end - p));
+    if (p < end && *p == '-') {
+        version->pre = p + 1;
+        version->pre_end = build ? build : end;
+        if (version_semver_identifiers(version->pre, version->pre_end, 1) < 0) {
+            return -1;
+        }
+        p = version->pre_end;
+    }
+    if (p < end && *p == '+') {
+        // Build metadata is checked but does not take part in ordering
+        return version_semver_identifiers(p + 1, end, 0);
+    }
+    return p == end ? 0 : -1;
+}
+
+/**
+ * Compare SemVer 2.0 versions
+ * @return -1, 0, 1 or VCMP_CMP_ERROR
+ */
+static int version_semver_cmp(const char *aa, const char *end_a, const char *bb, const char *end_b) {
+    struct version_semver a, b;
+    const char *pa, *pb;
+
+    if (version_semver_parse(aa, end_a, &a) < 0 || version_semver_parse(bb, end_b, &b) < 0) {
+        return VCMP_CMP_ERROR;
+    }
+    for (int i = 0; i < 3; i++) {
+        int result = version_digits_cmp(a.core[i], a.core_len[i], b.core[i], b.core_len[i]);
+        if (result) {
+            return result;
+        }
+    }
+
+    // Releases are the common case, and a release sorts above its pre-releases
+    if (!a.pre || !b.pre) {
+        return !a.pre - !b.pre;
+    }
+
+    pa = a.pre;
+    pb = b.pre;
+    while (pa < a.pre_end && pb < b.pre_end) {
+        const char *ea = memchr(pa, '.', (size_t) (a.pre_end - pa));
+        const char *eb = memchr(pb, '.', (size_t) (b.pre_end - pb));
+        size_t len_a, len_b;
+        int numeric_a, numeric_b, result;
+
+        ea = ea ? ea : a.pre_end;
+        eb = eb ? eb : b.pre_end;
+        len_a = (size_t) (ea - pa);
+        len_b = (size_t) (eb - pb);
+        numeric_a = version_digits_len(pa, ea) == len_a;
+        numeric_b = version_digits_len(pb, eb) == len_b;
+
+        // Numeric identifiers sort below alphanumeric ones
+        if (numeric_a != numeric_b) {
+            return numeric_a ? -1 : 1;
+        }
+        if (numeric_a) {
+            result = version_digits_cmp(pa, len_a, pb, len_b);
+        } else {
+            result = memcmp(pa, pb, len_a < len_b ? len_a : len_b);
+            result = result ? result : (len_a > len_b) - (len_a < len_b);
+        }
+        if (result) {
+            return (result > 0) - (result < 0);
+        }
+        pa = ea + (ea < a.pre_end);
+        pb = eb + (eb < b.pre_end);
+    }
+    return (pa < a.pre_end) - (pb < b.pre_end);
+}
+
+#define VERSION_PEP440_DEV 0
+#define VERSION_PEP440_PRE 1
+#define VERSION_PEP440_FINAL 2
+
+struct version_pep440 {
+    const char *epoch;
+    size_t epoch_len;
+    const char *release;
+    const char *release_end;
+    int stage;
+    int pre;
+    const char *pre_n;
+    size_t pre_len;
+    int has_post;
+    const char *post_n;
+    size_t post_len;
+    int has_dev;
+    const char *dev_n;
+    size_t dev_len;
+    const char *local;
+    const char *local_end;
+};
+
+/**
+ * Skip an optional PEP 440 separator
+ * @param p position
+ * @param end end of the span
+ * @return position after the separator
+ */
+static const char *version_pep440_separator(const char *p, const char *end) {
+    return p < end && (*p == '.' || *p == '-' || *p == '_') ? p + 1 : p;
+}
+
+/**
+ * Parse an optional PEP 440 suffix: [sep] keyword [sep] [number]
+ * @param p position, advanced past the suffix if it matched
+ * @param end end of the span
+ * @param keywords spellings of the suffix, longest first
+ * @param match destination for the index of the spelling that matched
+ * @param number destination for the digits (length 0 means 0)
+ * @param len destination for the number of digits
+ * @return 1 if the suffix matched
+ * @return 0 if it did not
+ */
+static int version_pep440_suffix(const char **p, const char *end, const char *const *keywords, int *match,
+                                 const char **number, size_t *len) {
+    const char *ptr = version_pep440_separator(*p, end);
+
+    for (int i = 0; keywords[i]; i++) {
+        size_t keyword_len = version_keyword(ptr, end, keywords[i]);
+        const char *digits;
+
+        if (!keyword_len) {
+            continue;
+        }
+        digits = version_pep440_separator(ptr + keyword_len, end);
+        *len = version_digits_len(digits, end);
+        if (!*len) {
+            // The separator only belongs to the suffix if a number follows
+            digits = ptr + keyword_len;
+        }
+        *number = digits;
+        *p = digits + *len;
+        *match = i;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Parse a PEP 440 version: [N!]N(.N)*[{a|b|rc}N][.postN][.devN][+LOCAL]
+ *
+ * The normalizations of the specification are applied: case is ignored, a
+ * leading 'v' is accepted, alpha/beta/c/pre/preview/rev/r are alternate
+ * spellings, separators are optional and "-N" is a post-release.
+ *
+ * @param p start of the version
+ * @param end end of the version
+ * @param version destination
+ * @return 0 on success
+ * @return -1 on error
+ */
+static int version_pep440_parse(const char *p, const char *end, struct version_pep440 *version) {
+    static const char *const pre[] = {"preview", "alpha", "beta", "pre", "rc", "a", "b", "c", NULL};
+    static const int pre_rank[] = {2, 0, 1, 2, 2, 0, 1, 2};
+    static const char *const post[] = {"post", "rev", "r", NULL};
+    static const char *const dev[] = {"dev", NULL};
+    size_t len;
+    int match;
+
+    memset(version, 0, sizeof(*version));
+    if (p < end && (*p == 'v' || *p == 'V')) {
+        p++;
+    }
+
+    len = version_digits_len(p, end);
+    if (len && p + len < end && p[len] == '!') {
+        version->epoch = p;
+        version->epoch_len = len;
+        p += len + 1;
+    }
+
+    version->release = p;
+    while (1) {
+        len = version_digits_len(p, end);
+        if (!len) {
+            return -1;
+        }
+        p += len;
+        if (end - p < 2 || *p != '.' || !isdigit((unsigned char) p[1])) {
+            break;
+        }
+        p++;
+    }
+    version->release_end = p;
+
+    version->stage = VERSION_PEP440_FINAL;
+    if (version_pep440_suffix(&p, end, pre, &match, &version->pre_n, &version->pre_len)) {
+        version->stage = VERSION_PEP440_PRE;
+        version->pre = pre_rank[match];
+    }
+    if (p + 1 < end && *p == '-' && isdigit((unsigned char) p[1])) {
+        version->has_post = 1;
+        version->post_n = p + 1;
+        version->post_len = version_digits_len(p + 1, end);
+        p += 1 + version->post_len;
+    } else {
+        version->has_post = version_pep440_suffix(&p, end, post, &match, &version->post_n, &version->post_len);
+    }
+    version->has_dev = version_pep440_suffix(&p, end, dev, &match, &version->dev_n, &version->dev_len);
+    if (version->has_dev && version->stage == VERSION_PEP440_FINAL && !version->has_post) {
+        // 1.0.dev1 sorts below 1.0a1
+        version->stage = VERSION_PEP440_DEV;
+    }
+
+    if (p < end && *p == '+') {
+        version->local = ++p;
+        while (1) {
+            const char *start = p;
+
+            while (p < end && isalnum((unsigned char) *p)) {
+                p++;
+            }
+            if (p == start) {
+                return -1;
+            }
+            if (p == end) {
+                break;
+            }
+            if (*p != '.' && *p != '-' && *p != '_') {
+                return -1;
+            }
+            p++;
+        }
+        version->local_end = p;
+    }
+    return p == end ? 0 : -1;
+}
+
+/**
+ * Compare PEP 440 local version labels
+ * @return -1, 0 or 1
+ */
+static int version_pep440_local_cmp(const char *pa, const char *end_a, const char *pb, const char *end_b) {
+    while (pa < end_a && pb < end_b) {
+        const char *ea = pa, *eb = pb;
+        size_t len_a, len_b;
+        int numeric_a, numeric_b, result;
+
+        while (ea < end_a && isalnum((unsigned char) *ea)) {
+            ea++;
+        }
+        while (eb < end_b && isalnum((unsigned char) *eb)) {
+            eb++;
+        }
+        len_a = (size_t) (ea - pa);
+        len_b = (size_t) (eb - pb);
+        numeric_a = version_digits_len(pa, ea) == len_a;
+        numeric_b = version_digits_len(pb, eb) == len_b;
+
+        // Numeric segments sort above alphanumeric ones
+        if (numeric_a != numeric_b) {
+            return numeric_a ? 1 : -1;
+        }
+        if (numeric_a) {
+            result = version_digits_cmp(pa, len_a, pb, len_b);
+        } else {
+            result = strncasecmp(pa, pb, len_a < len_b ? len_a : len_b);
+            result = result ? result : (len_a > len_b) - (len_a < len_b);
+        }
+        if (result) {
+            return (result > 0) - (result < 0);
+        }
+        pa = ea + (ea < end_a);
+        pb = eb + (eb < end_b);
+    }
+    return (pa < end_a) - (pb < end_b);
+}
+
+/**
+ * Compare PEP 440 versions
+ * @return -1, 0, 1 or VCMP_CMP_ERROR
+ */
+static int version_pep440_cmp(const char *aa, const char *end_a, const char *bb, const char *end_b) {
+    struct version_pep440 a, b;
+    const char *pa, *pb;
+    int result;
+
+    if (version_pep440_parse(aa, end_a, &a) < 0 || version_pep440_parse(bb, end_b, &b) < 0) {
+        return VCMP_CMP_ERROR;
+    }
+    result = version_digits_cmp(a.epoch, a.epoch_len, b.epoch, b.epoch_len);
+    if (result) {
+        return result;
+    }
+
+    // Missing release segments are zero, so 1.0 == 1.0.0
+    pa = a.release;
+    pb = b.release;
+    while (pa < a.release_end || pb < b.release_end) {
+        size_t len_a = version_digits_len(pa, a.release_end);
+        size_t len_b = version_digits_len(pb, b.release_end);
+
+        result = version_digits_cmp(pa, len_a, pb, len_b);
+        if (result) {
+            return result;
+        }
+        pa += len_a + (pa + len_a < a.release_end);
+        pb += len_b + (pb + len_b < b.release_end);
+    }
+
+    // Final releases without suffixes are the common case
+    if (a.stage == VERSION_PEP440_FINAL && b.stage == VERSION_PEP440_FINAL
+        && !a.has_post && !b.has_post && !a.has_dev && !b.has_dev && !a.local && !b.local) {
+        return 0;
+    }
+
+    if (a.stage != b.stage) {
+        return a.stage < b.stage ? -1 : 1;
+    }
+    if (a.stage == VERSION_PEP440_PRE) {
+        if (a.pre != b.pre) {
+            return a.pre < b.pre ? -1 : 1;
+        }
+        result = version_digits_cmp(a.pre_n, a.pre_len, b.pre_n, b.pre_len);
+        if (result) {
+            return result;
+        }
+    }
+    if (a.has_post != b.has_post) {
+        return a.has_post - b.has_post;
+    }
+    if (a.has_post && (result = version_digits_cmp(a.post_n, a.post_len, b.post_n, b.post_len))) {
+        return result;
+    }
+    // A development release sorts below the release it leads up to
+    if (a.has_dev != b.has_dev) {
+        return b.has_dev - a.has_dev;
+    }
+    if (a.has_dev && (result = version_digits_cmp(a.dev_n, a.dev_len, b.dev_n, b.dev_len))) {
+        return result;
+    }
+    if (!a.local || !b.local) {
+        return !!a.local - !!b.local;
+    }
+    return version_pep440_local_cmp(a.local, a.local_end, b.local, b.local_end);
+}
+
+/**
+ * Split a version into [epoch:]version[-release], as Debian and RPM do
+ * @param p start of the version
+ * @param end end of the version
+ * @param epoch destination for the epoch digits (length 0 means 0)
+ * @param epoch_len destination for the number of epoch digits
+ * @param version destination for the version
+ * @param version_end destination for the end of the version
+ * @param release destination for the release (NULL if there is none)
+ * @param release_end destination for the end of the release
+ * @return 0 on success
+ * @return -1 on error
+ */
+static int version_evr_split(const char *p, const char *end, const char **epoch, size_t *epoch_len,
+                             const char **version, const char **version_end,
+                             const char **release, const char **release_end) {
+    const char *colon = memchr(p, ':', (size_t) (end - p));
+    const char *dash;
+
+    *epoch = p;
+    *epoch_len = 0;
+    if (colon) {
+        *epoch_len = version_digits_len(p, colon);
+        if (!*epoch_len || p + *epoch_len != colon) {
+            return -1;
+        }
+        p = colon + 1;
+    }
+
+    // The release starts after the last '-'
+    *release = NULL;
+    *release_end = NULL;
+    for (dash = end; dash > p && dash[-1] != '-'; dash--);
+    *version = p;
+    *version_end = end;
+    if (dash > p) {
+        *version_end = dash - 1;
+        *release = dash;
+        *release_end = end;
+        if (*release == *release_end) {
+            return -1;
+        }
+    }
+    for (const char *ptr = p; ptr < end; ptr++) {
+        if (isspace((unsigned char) *ptr) || *ptr == ':') {
+            return -1;
+        }
+    }
+    return *version < *version_end ? 0 : -1;
+}
+
+/**
+ * Debian sort weight of a character: '~' sorts below everything, even the
+ * end of the string, and letters sort below other punctuation
+ * @param p position
+ * @param end end of the span
+ * @return weight
+ */
+static int version_debian_order(const char *p, const char *end) {
+    if (p == end || isdigit((unsigned char) *p)) {
+        return 0;
+    }
+    if (isalpha((unsigned char) *p)) {
+        return (unsigned char) *p;
+    }
+    if (*p == '~') {
+        return -1;
+    }
+    return (unsigned char) *p + 256;
+}
+
+/**
+ * Compare Debian upstream versions or revisions, as dpkg's verrevcmp() does
+ * @return -1, 0 or 1
+ */
+static int version_debian_part_cmp(const char *a, const char *end_a, const char *b, const char *end_b) {
+    while (a < end_a || b < end_b) {
+        size_t len_a, len_b;
+        int result;
+
+        while ((a < end_a && !isdigit((unsigned char) *a)) || (b < end_b && !isdigit((unsigned char) *b))) {
+            int order_a = version_debian_order(a, end_a);
+            int order_b = version_debian_order(b, end_b);
+
+            if (order_a != order_b) {
+                return order_a < order_b ? -1 : 1;
+            }
+            a++;
+            b++;
+        }
+
+        len_a = version_digits_len(a, end_a);
+        len_b = version_digits_len(b, end_b);
+        result = version_digits_cmp(a, len_a, b, len_b);
+        if (result) {
+            return result;
+        }
+        a += len_a;
+        b += len_b;
+    }
+    return 0;
+}
+
+/**
+ * Compare Debian versions: [epoch:]upstream_version[-debian_revision]
+ * @return -1, 0, 1 or VCMP_CMP_ERROR
+ */
+static int version_debian_cmp(const char *aa, const char *end_a, const char *bb, const char *end_b) {
+    const char *epoch_a, *version_a, *version_end_a, *release_a, *release_end_a;
+    const char *epoch_b, *version_b, *version_end_b, *release_b, *release_end_b;
+    size_t epoch_len_a, epoch_len_b;
+    int result;
+
+    if (version_evr_split(aa, end_a, &epoch_a, &epoch_len_a, &version_a, &version_end_a, &release_a, &release_end_a) < 0
+        || version_evr_split(bb, end_b, &epoch_b, &epoch_len_b, &version_b, &version_end_b, &release_b, &release_end_b) < 0
+        || !isdigit((unsigned char) *version_a) || !isdigit((unsigned char) *version_b)) {
+        return VCMP_CMP_ERROR;
+    }
+
+    // Identical strings are equal, whatever they contain
+    if (end_a - aa == end_b - bb && !memcmp(aa, bb, (size_t) (end_a - aa))) {
+        return 0;
+    }
+    result = version_digits_cmp(epoch_a, epoch_len_a, epoch_b, epoch_len_b);
+    if (!result) {
+        result = version_debian_part_cmp(version_a, version_end_a, version_b, version_end_b);
+    }
+    if (!result) {
+        // A missing revision compares like an empty one
+        result = version_debian_part_cmp(release_a, release_end_a, release_b, release_end_b);
+    }
+    return result;
+}
+
+/**
+ * Compare RPM version or release strings, as rpm's rpmvercmp() does
+ * @return -1, 0 or 1
+ */
+static int version_rpm_part_cmp(const char *a, const char *end_a, const char *b, const char *end_b) {
+    if (end_a - a == end_b - b && (a == b || !memcmp(a, b, (size_t) (end_a - a)))) {
+        return 0;
+    }
+
+    while (a < end_a || b < end_b) {
+        const char *sa, *sb;
+        size_t len_a, len_b;
+        int numeric, result;
+
+        while (a < end_a && !isalnum((unsigned char) *a) && *a != '~' && *a != '^') {
+            a++;
+        }
+        while (b < end_b && !isalnum((unsigned char) *b) && *b != '~' && *b != '^') {
+            b++;
+        }
+
+        // '~' sorts below everything, even the end of the string
+        if ((a < end_a && *a == '~') || (b < end_b && *b == '~')) {
+            if (a == end_a || *a != '~') {
+                return 1;
+            }
+            if (b == end_b || *b != '~') {
+                return -1;
+            }
+            a++;
+            b++;
+            continue;
+        }
+        // '^' sorts above the end of the string, but below everything else
+        if ((a < end_a && *a == '^') || (b < end_b && *b == '^')) {
+            if (a == end_a) {
+                return -1;
+            }
+            if (b == end_b) {
+                return 1;
+            }
+            if (*a != '^') {
+                return 1;
+            }
+            if (*b != '^') {
+                return -1;
+            }
+            a++;
+            b++;
+            continue;
+        }
+        if (a == end_a || b == end_b) {
+            break;
+        }
+
+        sa = a;
+        sb = b;
+        numeric = isdigit((unsigned char) *a) != 0;
+        if (numeric) {
+            a += version_digits_len(a, end_a);
+            b += version_digits_len(b, end_b);
+        } else {
+            while (a < end_a && isalpha((unsigned char) *a)) {
+                a++;
+            }
+            while (b < end_b && isalpha((unsigned char) *b)) {
+                b++;
+            }
+        }
+        len_a = (size_t) (a - sa);
+        len_b = (size_t) (b - sb);
+
+        // A number sorts above letters
+        if (!len_b) {
+            return numeric ? 1 : -1;
+        }
+        if (numeric) {
+            result = version_digits_cmp(sa, len_a, sb, len_b);
+        } else {
+            result = memcmp(sa, sb, len_a < len_b ? len_a : len_b);
+            result = result ? (result > 0) - (result < 0) : (len_a > len_b) - (len_a < len_b);
+        }
+        if (result) {
+            return result;
+        }
+    }
+    return (a < end_a) - (b < end_b);
+}
+
+/**
+ * Compare RPM versions: [epoch:]version[-release]
+ * @return -1, 0, 1 or VCMP_CMP_ERROR
+ */
+static int version_rpm_cmp(const char *aa, const char *end_a, const char *bb, const char *end_b) {
+    const char *epoch_a, *version_a, *version_end_a, *release_a, *release_end_a;
+    const char *epoch_b, *version_b, *version_end_b, *release_b, *release_end_b;
+    size_t epoch_len_a, epoch_len_b;
+    int result;
+
+    if (version_evr_split(aa, end_a, &epoch_a, &epoch_len_a, &version_a, &version_end_a, &release_a, &release_end_a) < 0
+        || version_evr_split(bb, end_b, &epoch_b, &epoch_len_b, &version_b, &version_end_b, &release_b, &release_end_b) < 0) {
+        return VCMP_CMP_ERROR;
+    }
+    result = version_digits_cmp(epoch_a, epoch_len_a, epoch_b, epoch_len_b);
+    if (!result) {
+        result = version_rpm_part_cmp(version_a, version_end_a, version_b, version_end_b);
+    }
+    if (!result) {
+        // A missing release compares like an empty one
+        result = version_rpm_part_cmp(release_a, release_end_a, release_b, release_end_b);
+    }
+    return result;
+}
+
+/**
+ * Three-way comparison of version spans under an ordering scheme
+ * @see version_cmp_scheme()
+ * @param scheme one of VCMP_SCHEME_*
+ * @param aa version1 span
+ * @param len_a length of aa
+ * @param bb version2 span
+ * @param len_b length of bb
+ * @return -1, 0, 1 or VCMP_CMP_ERROR
+ */
+int version_cmp_scheme_n(int scheme, const char *aa, size_t len_a, const char *bb, size_t len_b) {
+    VERSION_STATS_START(start);
+    int result;
+
+    if (!aa || !bb) {
+        return VCMP_CMP_ERROR;
+    }
+    if (scheme == VCMP_SCHEME_DEFAULT) {
+        return version_cmp_n(aa, len_a, bb, len_b);
+    }
+
+    aa = vcmp_lstrip_n(aa, &len_a);
+    bb = vcmp_lstrip_n(bb, &len_b);
+    len_a = vcmp_rstrip_n(aa, len_a);
+    len_b = vcmp_rstrip_n(bb, len_b);
+    switch (scheme) {
+        case VCMP_SCHEME_SEMVER:
+            result = version_semver_cmp(aa, aa + len_a, bb, bb + len_b);
+            break;
+        case VCMP_SCHEME_PEP440:
+            result = version_pep440_cmp(aa, aa + len_a, bb, bb + len_b);
+            break;
+        case VCMP_SCHEME_DEBIAN:
+            result = version_debian_cmp(aa, aa + len_a, bb, bb + len_b);
+            break;
+        case VCMP_SCHEME_RPM:
+            result = version_rpm_cmp(aa, aa + len_a, bb, bb + len_b);
+            break;
+        default:
+            return VCMP_CMP_ERROR;
+    }
+    // The scheme comparators also walk both versions in full
+    VERSION_STATS_WALK(len_a + len_b, result, start);
+    return result;
+}
+
+/**
+ * Three-way comparison of version strings under an ordering scheme
+ *
+ * VCMP_SCHEME_DEFAULT is version_cmp(). The other schemes follow their
+ * specifications, including pre-release and build metadata rules, and
+ * reject strings that are not valid in them.
+ *
+ * @param scheme one of VCMP_SCHEME_*
+ * @param aa version1
+ * @param bb version2
+ * @return -1, 0, 1 or VCMP_CMP_ERROR
+ */
+int version_cmp_scheme(int scheme, const char *aa, const char *bb) {
+    if (!aa || !bb) {
+        return VCMP_CMP_ERROR;
+    }
+    if (scheme == VCMP_SCHEME_DEFAULT) {
+        return version_cmp(aa, bb);
+    }
+    return version_cmp_scheme_n(scheme, aa, strlen(aa), bb, strlen(bb));
+}
+
+/**
+ * Compare version spans under an ordering scheme based on flag(s)
+ * @see version_compare_scheme()
+ * @param scheme one of VCMP_SCHEME_*
+ * @param flags version operators
+ * @param aa version1 span
+ * @param len_a length of aa
+ * @param bb version2 span
+ * @param len_b length of bb
+ * @return 1 flag operation is true
+ * @return 0 flag operation is false
+ * @return -1 on error
+ */
+int version_compare_scheme_n(int scheme, int flags, const char *aa, size_t len_a, const char *bb, size_t len_b) {
+    VERSION_STATS_START(start);
+    int result = -1;
+
+    if (scheme == VCMP_SCHEME_DEFAULT) {
+        return version_compare_n(flags, aa, len_a, bb, len_b);
+    }
+    if (flags > 0) {
+        result = version_compare_result(flags, version_cmp_scheme_n(scheme, aa, len_a, bb, len_b));
+    }
+    VERSION_STATS_COMPARE(flags, result, start);
+    return result;
+}
+
+/**
+ * Compare version strings under an ordering scheme based on flag(s)
+ * @param scheme one of VCMP_SCHEME_*
+ * @param flags version operators
+ * @param aa version1
+ * @param bb version2
+ * @return 1 flag operation is true
+ * @return 0 flag operation is false
+ * @return -1 on error
+ */
+int version_compare_scheme(int scheme, int flags, const char *aa, const char *bb) {
+    VERSION_STATS_START(start);
+    int result = -1;
+
+    if (scheme == VCMP_SCHEME_DEFAULT) {
+        return version_compare(flags, aa, bb);
+    }
+    if (flags > 0) {
+        result = version_compare_result(flags, version_cmp_scheme(scheme, aa, bb));
+    }
+    VERSION_STATS_COMPARE(flags, result, start);
+    return result;
+}
+
+/**
+ * Initialize a scratch context
+ *
+ * A context owns a bump arena for the temporary state of the _ctx functions,
+ * so they do not touch the shared heap. Give each thread its own context.
+ * Requests that do not fit in the arena fall back to malloc().
+ *
+ * @param ctx destination, release with version_context_free()
+ * @param size arena size in bytes (0 for VCMP_CONTEXT_DEFAULT_SIZE)
+ * @return 0 on success
+ * @return -1 on error
+ */
+int version_context_init(vcmp_context *ctx, size_t size) {
+    if (!ctx) {
+        return -1;
+    }
+    if (!size) {
+        size = VCMP_CONTEXT_DEFAULT_SIZE;
+    }
+
+    ctx->used = 0;
+    ctx->size = size;
+    ctx->arena = malloc(size);
+    if (!ctx->arena) {
+        ctx->size = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Release a scratch context
+ * @param ctx context
+ */
+void version_context_free(vcmp_context *ctx) {
+    if (!ctx) {
+        return;
+    }
+    free(ctx->arena);
+    ctx->arena = NULL;
+    ctx->size = 0;
+    ctx->used = 0;
+}
+
+/**
+ * Allocate temporary memory from a context
+ *
+ * Arena memory is reclaimed when the caller restores ctx->used to the value
+ * it had on entry. Release fallback allocations with version_scratch_free().
+ *
+ * @param ctx context, or NULL to use malloc()
+ * @param size bytes
+ * @return pointer to 16-byte aligned memory
+ * @return NULL on error
+ */
+static void *version_scratch_alloc(vcmp_context *ctx, size_t size) {
+    size_t used;
+
+    if (ctx && ctx->arena) {
+        used = (ctx->used + 15) & ~(size_t) 15;
+        if (used <= ctx->size && size <= ctx->size - used) {
+            ctx->used = used + size;
+            return ctx->arena + used;
+        }
+    }
+    return malloc(size);
+}
+
+/**
+ * Release memory from version_scratch_alloc()
+ * @param ctx context, or NULL
+ * @param ptr memory (arena memory is left for the caller to reclaim)
+ */
+static void version_scratch_free(vcmp_context *ctx, void *ptr) {
+    unsigned char *mem = ptr;
+
+    if (ctx && ctx->arena && mem >= ctx->arena && mem < ctx->arena + ctx->size) {
+        return;
+    }
+    free(ptr);
+}
+
+/**
+ * Compare two interval bounds
+ * @param a bound version
+ * @param a_flags VCMP_BOUND_* flags of a
+ * @param b bound version
+ * @param b_flags VCMP_BOUND_* flags of b
+ * @param high non-zero when comparing upper bounds
+ * @return -1, 0 or 1
+ */
+static int version_bound_cmp(const vcmp_version *a, int a_flags, const vcmp_version *b, int b_flags, int high) {
+    int result;
+
+    if ((a_flags & VCMP_BOUND_UNBOUNDED) || (b_flags & VCMP_BOUND_UNBOUNDED)) {
+        if ((a_flags & VCMP_BOUND_UNBOUNDED) && (b_flags & VCMP_BOUND_UNBOUNDED)) {
+            return 0;
+        }
+        result = (a_flags & VCMP_BOUND_UNBOUNDED) ? -1 : 1;
+        return high ? -result : result;
+    }
+
+    result = version_cmp_parsed(a, b);
+    if (result || (a_flags & VCMP_BOUND_INCLUSIVE) == (b_flags & VCMP_BOUND_INCLUSIVE)) {
+        return result;
+    }
+    // At the same version an inclusive lower bound starts first and an
+    // inclusive upper bound ends last
+    result = (a_flags & VCMP_BOUND_INCLUSIVE) ? -1 : 1;
+    return high ? -result : result;
+}
+
+/**
+ * Determine whether an interval contains at least one version
+ * @param interval interval to check
+ * @return 1 if the interval is not empty
+ * @return 0 if the interval is empty
+ */
+static int version_interval_nonempty(const vcmp_interval *interval) {
+    int result;
+
+    if ((interval->low_flags & VCMP_BOUND_UNBOUNDED) || (interval->high_flags & VCMP_BOUND_UNBOUNDED)) {
+        return 1;
+    }
+    result = version_cmp_parsed(&interval->low, &interval->high);
+    if (!result) {
+        return (interval->low_flags & VCMP_BOUND_INCLUSIVE) && (interval->high_flags & VCMP_BOUND_INCLUSIVE);
+    }
+    return result < 0;
+}
+
+/**
+ * Determine whether an interval overlaps or touches the one before it
+ * @param last interval with the lower start
+ * @param next interval with the higher start
+ * @return 1 if the intervals can be merged
+ * @return 0 if there is a gap between them
+ */
+static int version_interval_joins(const vcmp_interval *last, const vcmp_interval *next) {
+    int result;
+
+    if ((last->high_flags & VCMP_BOUND_UNBOUNDED) || (next->low_flags & VCMP_BOUND_UNBOUNDED)) {
+        return 1;
+    }
+    result = version_cmp_parsed(&next->low, &last->high);
+    if (result) {
+        return result < 0;
+    }
+    // Touching at a single version joins when either side includes it
+    return ((next->low_flags | last->high_flags) & VCMP_BOUND_INCLUSIVE) != 0;
+}
+
+static int version_interval_cmp_low(const void *pa, const void *pb) {
+    const vcmp_interval *a = pa;
+    const vcmp_interval *b = pb;
+    return version_bound_cmp(&a->low, a->low_flags, &b->low, b->low_flags, 0);
+}
+
+/**
+ * Convert a single "{operator} {version}" clause to intervals
+ * @param flags version operators
+ * @param version bound
+ * @param result destination with room for two intervals
+ * @return number of intervals written
+ */
+static size_t version_clause_intervals(int flags, const vcmp_version *version, vcmp_interval *result) {
+    vcmp_interval interval;
+
+    memset(&interval, 0, sizeof(interval));
+    interval.low = *version;
+    interval.high = *version;
+
+    // Same precedence as version_compare_result()
+    if (flags & GT && flags & EQ) {
+        interval.low_flags = VCMP_BOUND_INCLUSIVE;
+        interval.high_flags = VCMP_BOUND_UNBOUNDED;
+    } else if (flags & LT && flags & EQ) {
+        interval.low_flags = VCMP_BOUND_UNBOUNDED;
+        interval.high_flags = VCMP_BOUND_INCLUSIVE;
+    } else if (flags & NOT && flags & EQ) {
+        interval.low_flags = VCMP_BOUND_UNBOUNDED;
+        interval.high_flags = 0;
+        result[0] = interval;
+        interval.low_flags = 0;
+        interval.high_flags = VCMP_BOUND_UNBOUNDED;
+        result[1] = interval;
+        return 2;
+    } else if (flags & GT) {
+        interval.low_flags = 0;
+        interval.high_flags = VCMP_BOUND_UNBOUNDED;
+    } else if (flags & LT) {
+        interval.low_flags = VCMP_BOUND_UNBOUNDED;
+        interval.high_flags = 0;
+    } else if (flags & EQ) {
+        interval.low_flags = VCMP_BOUND_INCLUSIVE;
+        interval.high_flags = VCMP_BOUND_INCLUSIVE;
+    } else {
+        return 0;
+    }
+
+    result[0] = interval;
+    return 1;
+}
+
+/**
+ * Intersect two sorted sets of disjoint intervals
+ * @param ctx scratch context, or NULL
+ * @param a first set
+ * @param b second set
+ * @param result destination set
+ * @return 0 on success
+ * @return -1 on error
+ */
+static int version_constraint_intersect(vcmp_context *ctx, const vcmp_constraint *a, const vcmp_constraint *b,
+                                        vcmp_constraint *result) {
+    size_t i, j;
+
+    result->count = 0;
+    result->interval = version_scratch_alloc(ctx, (a->count + b->count + 1) * sizeof(*result->interval));
+    if (!result->interval) {
+        return -1;
+    }
+
+    i = 0;
+    j = 0;
+    while (i < a->count && j < b->count) {
+        const vcmp_interval *x = &a->interval[i];
+        const vcmp_interval *y = &b->interval[j];
+        vcmp_interval *out = &result->interval[result->count];
+
+        if (version_bound_cmp(&x->low, x->low_flags, &y->low, y->low_flags, 0) >= 0) {
+            out->low = x->low;
+            out->low_flags = x->low_flags;
+        } else {
+            out->low = y->low;
+            out->low_flags = y->low_flags;
+        }
+
+        if (version_bound_cmp(&x->high, x->high_flags, &y->high, y->high_flags, 1) <= 0) {
+            out->high = x->high;
+            out->high_flags = x->high_flags;
+            i++;
+        } else {
+            out->high = y->high;
+            out->high_flags = y->high_flags;
+            j++;
+        }
+
+        if (version_interval_nonempty(out)) {
+            result->count++;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Merge two sorted sets of disjoint intervals
+ * @param ctx scratch context, or NULL
+ * @param a first set
+ * @param b second set
+ * @param result destination set
+ * @return 0 on success
+ * @return -1 on error
+ */
+static int version_constraint_union(vcmp_context *ctx, const vcmp_constraint *a, const vcmp_constraint *b,
+                                    vcmp_constraint *result) {
+    vcmp_interval *all;
+    size_t count;
+
+    result->count = 0;
+    result->interval = version_scratch_alloc(ctx, (a->count + b->count + 1) * sizeof(*result->interval));
+    if (!result->interval) {
+        return -1;
+    }
+
+    all = result->interval;
+    count = a->count + b->count;
+    if (a->count) {
+        memcpy(all, a->interval, a->count * sizeof(*all));
+    }
+    if (b->count) {
+        memcpy(all + a->count, b->interval, b->count * sizeof(*all));
+    }
+    qsort(all, count, sizeof(*all), version_interval_cmp_low);
+
+    for (size_t i = 0; i < count; i++) {
+        vcmp_interval *last = result->count ? &result->interval[result->count - 1] : NULL;
+
+        if (last && version_interval_joins(last, &all[i])) {
+            if (version_bound_cmp(&all[i].high, all[i].high_flags, &last->high, last->high_flags, 1) > 0) {
+                last->high = all[i].high;
+                last->high_flags = all[i].high_flags;
+            }
+            continue;
+        }
+        result->interval[result->count++] = all[i];
+    }
+    return 0;
+}
+
+/**
+ * Compile a version constraint expression
+ *
+ * An expression is a list of "{operator}{version}" clauses. Clauses separated
+ * by ',' must all hold, and groups separated by "||" are alternatives:
+ *
+ *     >=1.2, <2.0, !=1.5.3 || >=3.0
+ *
+ * A clause without an operator means '='. The expression is compiled into a
+ * sorted list of disjoint intervals, which version_constraint_match() tests
+ * with a binary search.
+ *
+ * @param ctx scratch context for the intervals, or NULL to allocate them
+ * @param expr constraint expression
+ * @param constraint destination
+ * @return 0 on success
+ * @return -1 on error
+ */
+static int version_constraint_parse_with(vcmp_context *ctx, const char *expr, vcmp_constraint *constraint) {
+    vcmp_constraint result, group;
+    const char *ptr;
+
+    if (!expr || !constraint || vcmp_isempty(expr)) {
+        return -1;
+    }
+
+    constraint->interval = NULL;
+    constraint->count = 0;
+    result.interval = NULL;
+    result.count = 0;
+    group.interval = NULL;
+    group.count = 0;
+
+    ptr = expr;
+    while (1) {
+        vcmp_interval clause_interval[2];
+        vcmp_constraint clause, tmp;
+        vcmp_version version;
+        size_t len;
+        int flags;
+
+        while (isspace((unsigned char) *ptr)) {
+            ptr++;
+        }
+
+        len = strspn(ptr, "><=!");
+        if (len) {
+            flags = version_parse_operator_n(ptr, len);
+            if (flags < 0) {
+                goto version_constraint_parse_failed;
+            }
+            ptr += len;
+        } else {
+            flags = EQ;
+        }
+
+        while (isspace((unsigned char) *ptr)) {
+            ptr++;
+        }
+        len = strcspn(ptr, ",| \t\r\n");
+        if (!len || version_parse_n(ptr, len, &version) < 0) {
+            goto version_constraint_parse_failed;
+        }
+        ptr += len;
+
+        clause.interval = clause_interval;
+        clause.count = version_clause_intervals(flags, &version, clause_interval);
+        if (!group.interval) {
+            tmp.interval = version_scratch_alloc(ctx, sizeof(clause_interval));
+            if (!tmp.interval) {
+                goto version_constraint_parse_failed;
+            }
+            memcpy(tmp.interval, clause_interval, sizeof(clause_interval));
+            tmp.count = clause.count;
+        } else if (version_constraint_intersect(ctx, &group, &clause, &tmp) < 0) {
+            goto version_constraint_parse_failed;
+        }
+        version_scratch_free(ctx, group.interval);
+        group = tmp;
+
+        while (isspace((unsigned char) *ptr)) {
+            ptr++;
+        }
+        if (*ptr == ',') {
+            ptr++;
+            continue;
+        }
+
+        if (version_constraint_union(ctx, &result, &group, &tmp) < 0) {
+            goto version_constraint_parse_failed;
+        }
+        version_scratch_free(ctx, result.interval);
+        result = tmp;
+        version_scratch_free(ctx, group.interval);
+        group.interval = NULL;
+        group.count = 0;
+
+        if (*ptr == '|' && *(ptr + 1) == '|') {
+            ptr += 2;
+            continue;
+        }
+        if (*ptr != '\0') {
+            goto version_constraint_parse_failed;
+        }
+        break;
+    }
+
+    *constraint = result;
+    return 0;
+
+version_constraint_parse_failed:
+    version_scratch_free(ctx, group.interval);
+    version_scratch_free(ctx, result.interval);
+    return -1;
+}
+
+/**
+ * Compile a version constraint expression
+ * @see version_constraint_parse_with()
+ * @param expr constraint expression
+ * @param constraint destination, release with version_constraint_free()
+ * @return 0 on success
+ * @return -1 on error
+ */
+int version_constraint_parse(const char *expr, vcmp_constraint *constraint) {
+    return version_constraint_parse_with(NULL, expr, constraint);
+}
+
+/**
+ * Test a parsed version against a compiled constraint
+ * @param constraint compiled constraint
+ * @param version parsed version
+ * @return 1 if the version satisfies the constraint
+ * @return 0 if the version does not satisfy the constraint
+ * @return -1 on error
+ */
+int version_constraint_match(const vcmp_constraint *constraint, const vcmp_version *version) {
+    VERSION_STATS_START(start);
+    size_t low, high;
+    const vcmp_interval *interval;
+    int result;
+
+    if (!constraint || !version) {
+        VERSION_STATS_COMPARE(0, -1, start);
+        return -1;
+    }
+
+    // Find the last interval that starts at or before the version
+    low = 0;
+    high = constraint->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        interval = &constraint->interval[mid];
+        if (version_bound_cmp(&interval->low, interval->low_flags, version, VCMP_BOUND_INCLUSIVE, 0) <= 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    result = 0;
+    if (low) {
+        interval = &constraint->interval[low - 1];
+        result = version_bound_cmp(version, VCMP_BOUND_INCLUSIVE, &interval->high, interval->high_flags, 1) <= 0;
+    }
+    // A constraint has no single operator, only the totals are counted
+    VERSION_STATS_COMPARE(0, result, start);
+    return result;
+}
+
+/**
+ * Test a version string against a constraint expression
+ * @see version_constraint_parse()
+ * @param str version string
+ * @param expr constraint expression
+ * @return 1 if the version satisfies the constraint
+ * @return 0 if the version does not satisfy the constraint
+ * @return -1 on error
+ */
+int version_satisfies(const char *str, const char *expr) {
+    vcmp_constraint constraint;
+    vcmp_version version;
+    int result;
+
+    if (version_parse(str, &version) < 0 || version_constraint_parse(expr, &constraint) < 0) {
+        return -1;
+    }
+    result = version_constraint_match(&constraint, &version);
+    version_constraint_free(&constraint);
+    return result;
+}
+
+/**
+ * Test a version string against a constraint expression using a scratch
+ * context
+ *
+ * The compiled constraint lives in the context's arena, so this does not
+ * allocate unless the expression outgrows the arena.
+ *
+ * @see version_satisfies()
+ * @param ctx scratch context
+ * @param str version string
+ * @param expr constraint expression
+ * @return 1 if the version satisfies the constraint
+ * @return 0 if the version does not satisfy the constraint
+ * @return -1 on error
+ */
+int version_satisfies_ctx(vcmp_context *ctx, const char *str, const char *expr) {
+    vcmp_constraint constraint;
+    vcmp_version version;
+    size_t used;
+    int result;
+
+    if (!ctx || version_parse(str, &version) < 0) {
+        return -1;
+    }
+
+    used = ctx->used;
+    if (version_constraint_parse_with(ctx, expr, &constraint) < 0) {
+        ctx->used = used;
+        return -1;
+    }
+    result = version_constraint_match(&constraint, &version);
+    version_scratch_free(ctx, constraint.interval);
+    ctx->used = used;
+    return result;
+}
+
+/**
+ * Select the highest or lowest candidate that satisfies a constraint
+ * @param constraint compiled constraint
+ * @param candidates parsed versions
+ * @param n number of candidates
+ * @param highest non-zero to select the highest version, zero for the lowest
+ * @param index destination for the position of the selected candidate
+ * @return 1 if a candidate was selected
+ * @return 0 if no candidate satisfies the constraint
+ * @return -1 on error
+ */
+static int version_select(const vcmp_constraint *constraint, const vcmp_version *candidates, size_t n, int highest, size_t *index) {
+    const vcmp_version *best;
+
+    if (!constraint || (!candidates && n) || !index) {
+        return -1;
+    }
+
+    best = NULL;
+    for (size_t i = 0; i < n; i++) {
+        // Ordering is cheaper than matching, so reject on it first
+        if (best) {
+            int result = version_cmp_parsed(&candidates[i], best);
+            if (highest ? result <= 0 : result >= 0) {
+                continue;
+            }
+        }
+        if (version_constraint_match(constraint, &candidates[i]) == 1) {
+            best = &candidates[i];
+            *index = i;
+        }
+    }
+    return best != NULL;
+}
+
+/**
+ * Select the highest candidate that satisfies a constraint
+ *
+ * The candidates are scanned once. When several candidates are equal the
+ * first one wins.
+ *
+ * @param constraint compiled constraint
+ * @param candidates parsed versions
+ * @param n number of candidates
+ * @param index destination for the position of the selected candidate
+ * @return 1 if a candidate was selected
+ * @return 0 if no candidate satisfies the constraint
+ * @return -1 on error
+ */
+int version_select_max(const vcmp_constraint *constraint, const vcmp_version *candidates, size_t n, size_t *index) {
+    return version_select(constraint, candidates, n, 1, index);
+}
+
+/**
+ * Select the lowest candidate that satisfies a constraint
+ * @see version_select_max()
+ */
+int version_select_min(const vcmp_constraint *constraint, const vcmp_version *candidates, size_t n, size_t *index) {
+    return version_select(constraint, candidates, n, 0, index);
+}
+
+static int version_candidate_cmp(const void *pa, const void *pb) {
+    const vcmp_version *a = *(const vcmp_version * const *) pa;
+    const vcmp_version *b = *(const vcmp_version * const *) pb;
+    int result;
+
+    result = version_cmp_parsed(a, b);
+    if (!result) {
+        result = (a > b) - (a < b);
+    }
+    return result;
+}
+
+/**
+ * Build a sorted index over a list of candidates
+ *
+ * The index refers to the caller's array, which must outlive it. Use it with
+ * version_candidates_select_max() and version_candidates_select_min() when
+ * the same candidates are queried repeatedly.
+ *
+ * @param candidates destination, release with version_candidates_free()
+ * @param versions parsed versions
+ * @param n number of versions
+ * @return 0 on success
+ * @return -1 on error
+ */
+int version_candidates_init(vcmp_candidates *candidates, const vcmp_version *versions, size_t n) {
+    const vcmp_version **sorted;
+
+    if (!candidates || (!versions && n)) {
+        return -1;
+    }
+
+    candidates->version = versions;
+    candidates->order = malloc((n ? n : 1) * sizeof(*candidates->order));
+    sorted = malloc((n ? n : 1) * sizeof(*sorted));
+    if (!candidates->order || !sorted) {
+        free(candidates->order);
+        free(sorted);
+        candidates->order = NULL;
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        sorted[i] = &versions[i];
+    }
+    qsort(sorted, n, sizeof(*sorted), version_candidate_cmp);
+    for (size_t i = 0; i < n; i++) {
+        candidates->order[i] = (size_t) (sorted[i] - versions);
+    }
+    candidates->count = n;
+
+    free(sorted);
+    return 0;
+}
+
+/**
+ * Count the sorted candidates that fall below a bound
+ * @param candidates sorted index
+ * @param bound bound version
+ * @param flags VCMP_BOUND_* flags of the bound
+ * @param high non-zero for an upper bound (count candidates within it),
+ *             zero for a lower bound (count candidates before it)
+ * @return number of leading candidates
+ */
+static size_t version_candidates_bound(const vcmp_candidates *candidates, const vcmp_version *bound, int flags, int high) {
+    size_t low, end;
+
+    low = 0;
+    end = candidates->count;
+    while (low < end) {
+        size_t mid = low + (end - low) / 2;
+        const vcmp_version *version = &candidates->version[candidates->order[mid]];
+        int below;
+
+        if (high) {
+            below = version_bound_cmp(version, VCMP_BOUND_INCLUSIVE, bound, flags, 1) <= 0;
+        } else {
+            below = version_bound_cmp(bound, flags, version, VCMP_BOUND_INCLUSIVE, 0) > 0;
+        }
+
+        if (below) {
+            low = mid + 1;
+        } else {
+            end = mid;
+        }
+    }
+    return low;
+}
+
+/**
+ * Select the highest candidate that satisfies a constraint using a sorted index
+ *
+ * Each interval of the constraint is located with a binary search, so a query
+ * costs O(k log n) for k intervals. When several candidates are equal the one
+ * with the lowest position wins, as with version_select_max().
+ *
+ * @param candidates sorted index
+ * @param constraint compiled constraint
+ * @param index destination for the position of the selected candidate
+ * @return 1 if a candidate was selected
+ * @return 0 if no candidate satisfies the constraint
+ * @return -1 on error
+ */
+int version_candidates_select_max(const vcmp_candidates *candidates, const vcmp_constraint *constraint, size_t *index) {
+    if (!candidates || !constraint || !index) {
+        return -1;
+    }
+
+    for (size_t i = constraint->count; i > 0; i--) {
+        const vcmp_interval *interval = &constraint->interval[i - 1];
+        const vcmp_version *version;
+        size_t pos;
+
+        pos = version_candidates_bound(candidates, &interval->high, interval->high_flags, 1);
+        if (!pos) {
+            // Nothing is below this interval, so nothing is below the earlier ones
+            return 0;
+        }
+
+        version = &candidates->version[candidates->order[pos - 1]];
+        if (version_bound_cmp(&interval->low, interval->low_flags, version, VCMP_BOUND_INCLUSIVE, 0) <= 0) {
+            // Step back to the first of any equal candidates
+            pos = version_candidates_bound(candidates, version, VCMP_BOUND_INCLUSIVE, 0);
+            *index = candidates->order[pos];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Select the lowest candidate that satisfies a constraint using a sorted index
+ * @see version_candidates_select_max()
+ */
+int version_candidates_select_min(const vcmp_candidates *candidates, const vcmp_constraint *constraint, size_t *index) {
+    if (!candidates || !constraint || !index) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < constraint->count; i++) {
+        const vcmp_interval *interval = &constraint->interval[i];
+        size_t pos;
+
+        pos = version_candidates_bound(candidates, &interval->low, interval->low_flags, 0);
+        if (pos == candidates->count) {
+            return 0;
+        }
+
+        if (version_bound_cmp(&candidates->version[candidates->order[pos]], VCMP_BOUND_INCLUSIVE,
+                              &interval->high, interval->high_flags, 1) <= 0) {
+            *index = candidates->order[pos];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Release a sorted candidate index
+ * @param candidates sorted index
+ */
+void version_candidates_free(vcmp_candidates *candidates) {
+    if (!candidates) {
+        return;
+    }
+    free(candidates->order);
+    candidates->order = NULL;
+    candidates->count = 0;
+}
+
+/**
+ * Release a compiled constraint
+ * @param constraint compiled constraint
+ */
+void version_constraint_free(vcmp_constraint *constraint) {
+    if (!constraint) {
+        return;
+    }
+    free(constraint->interval);
+    constraint->interval = NULL;
+    constraint->count = 0;
+}
+
+/**
+ * Hash a string (FNV-1a)
+ * @param str input string
+ * @return hash
+ */
+static uint64_t version_hash(const char *str) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (const unsigned char *ptr = (const unsigned char *) str; *ptr; ptr++) {
+        hash ^= *ptr;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * Initialize an empty version table
+ * @param table destination, release with version_table_free()
+ * @return 0 on success
+ * @return -1 on error
+ */
+int version_table_init(vcmp_table *table) {
+    if (!table) {
+        return -1;
+    }
+    memset(table, 0, sizeof(*table));
+    return 0;
+}
+
+/**
+ * Release a version table
+ * @param table version table
+ */
+void version_table_free(vcmp_table *table) {
+    if (!table) {
+        return;
+    }
+    free(table->pool);
+    free(table->offset);
+    free(table->hash);
+    free(table->version);
+    free(table->rank);
+    free(table->slot);
+    memset(table, 0, sizeof(*table));
+}
+
+/**
+ * Find the hash slot for a string
+ * @param table version table
+ * @param str version string
+ * @param hash hash of str
+ * @return position of the slot holding str, or of the empty slot where it belongs
+ */
+static size_t version_table_slot(const vcmp_table *table, const char *str, uint64_t hash) {
+    size_t mask = table->nslots - 1;
+    size_t pos = (size_t) hash & mask;
+
+    while (table->slot[pos]) {
+        int id = table->slot[pos] - 1;
+        if (table->hash[id] == hash && !strcmp(table->pool + table->offset[id], str)) {
+            break;
+        }
+        pos = (pos + 1) & mask;
+    }
+    return pos;
+}
+
+/**
+ * Double the number of hash slots
+ * @param table version table
+ * @return 0 on success
+ * @return -1 on error
+ */
+static int version_table_grow_slots(vcmp_table *table) {
+    size_t nslots = table->nslots ? table->nslots * 2 : 64;
+    int *slot;
+
+    slot = calloc(nslots, sizeof(*slot));
+    if (!slot) {
+        return -1;
+    }
+    free(table->slot);
+    table->slot = slot;
+    table->nslots = nslots;
+
+    for (size_t id = 0; id < table->count; id++) {
+        size_t pos = (size_t) table->hash[id] & (nslots - 1);
+        while (slot[pos]) {
+            pos = (pos + 1) & (nslots - 1);
+        }
+        slot[pos] = (int) id + 1;
+    }
+    return 0;
+}
+
+/**
+ * Make room for one more entry
+ * @param table version table
+ * @param len length of the string to be stored
+ * @return 0 on success
+ * @return -1 on error
+ */
+static int version_table_reserve(vcmp_table *table, size_t len) {
+    if (table->count == table->size) {
+        size_t size = table->size ? table->size * 2 : 64;
+        size_t *offset;
+        uint64_t *hash;
+        vcmp_version *version;
+
+        offset = realloc(table->offset, size * sizeof(*offset));
+        if (!offset) {
+            return -1;
+        }
+        table->offset = offset;
+        hash = realloc(table->hash, size * sizeof(*hash));
+        if (!hash) {
+            return -1;
+        }
+        table->hash = hash;
+        version = realloc(table->version, size * sizeof(*version));
+        if (!version) {
+            return -1;
+        }
+        table->version = version;
+        table->size = size;
+    }
+
+    if (table->pool_used + len + 1 > table->pool_size) {
+        size_t size = table->pool_size ? table->pool_size : 4096;
+        char *pool;
+
+        while (table->pool_used + len + 1 > size) {
+            size *= 2;
+        }
+        pool = realloc(table->pool, size);
+        if (!pool) {
+            return -1;
+        }
+        table->pool = pool;
+        table->pool_size = size;
+    }
+
+    // Keep the load factor at or below 1/2
+    if ((table->count + 1) * 2 > table->nslots) {
+        return version_table_grow_slots(table);
+    }
+    return 0;
+}
+
+/**
+ * Intern a version string
+ *
+ * Every distinct string is stored and parsed once and assigned a dense
+ * integer ID, starting at 0. Interning a string that is already present
+ * returns its existing ID.
+ *
+ * @param table version table
+ * @param str version string
+ * @return ID of the string
+ * @return -1 on error, or if str is not a version
+ */
+int version_table_intern(vcmp_table *table, const char *str) {
+    vcmp_version version;
+    uint64_t hash;
+    size_t pos, len;
+    int id;
+
+    if (!table || !str) {
+        return -1;
+    }
+
+    hash = version_hash(str);
+    if (table->nslots) {
+        pos = version_table_slot(table, str, hash);
+        if (table->slot[pos]) {
+            return table->slot[pos] - 1;
+        }
+    }
+
+    if (table->count >= INT32_MAX - 1 || version_parse(str, &version) < 0) {
+        return -1;
+    }
+
+    len = strlen(str);
+    if (version_table_reserve(table, len) < 0) {
+        return -1;
+    }
+
+    id = (int) table->count++;
+    table->offset[id] = table->pool_used;
+    memcpy(table->pool + table->pool_used, str, len + 1);
+    table->pool_used += len + 1;
+    table->hash[id] = hash;
+    table->version[id] = version;
+    table->slot[version_table_slot(table, str, hash)] = id + 1;
+
+    // New entries invalidate the precomputed ranks
+    table->ranked = 0;
+    return id;
+}
+
+/**
+ * Look up the ID of a version string without interning it
+ * @param table version table
+ * @param str version string
+ * @return ID of the string
+ * @return -1 if the string is not in the table
+ */
+int version_table_find(const vcmp_table *table, const char *str) {
+    size_t pos;
+
+    if (!table || !str || !table->nslots) {
+        return -1;
+    }
+    pos = version_table_slot(table, str, version_hash(str));
+    return table->slot[pos] - 1;
+}
+
+/**
+ * Get the string of an interned version
+ * @param table version table
+ * @param id version ID
+ * @return version string
+ * @return NULL if the ID is invalid
+ */
+const char *version_table_string(const vcmp_table *table, int id) {
+    if (!table || id < 0 || (size_t) id >= table->count) {
+        return NULL;
+    }
+    return table->pool + table->offset[id];
+}
+
+/**
+ * Get the parsed form of an interned version
+ * @param table version table
+ * @param id version ID
+ * @return parsed version
+ * @return NULL if the ID is invalid
+ */
+const vcmp_version *version_table_get(const vcmp_table *table, int id) {
+    if (!table || id < 0 || (size_t) id >= table->count) {
+        return NULL;
+    }
+    return &table->version[id];
+}
+
+/**
+ * Precompute the rank of every interned version
+ *
+ * Once ranked, version_table_cmp() reduces to an integer comparison. Equal
+ * versions share a rank. Interning a new string drops the ranks until this
+ * is called again.
+ *
+ * @param table version table
+ * @return 0 on success
+ * @return -1 on error
+ */
+int version_table_rank(vcmp_table *table) {
+    const vcmp_version **sorted;
+    uint32_t *rank;
+    uint32_t current;
+
+    if (!table) {
+        return -1;
+    }
+    if (table->ranked) {
+        return 0;
+    }
+
+    rank = realloc(table->rank, (table->count ? table->count : 1) * sizeof(*rank));
+    if (!rank) {
+        return -1;
+    }
+    table->rank = rank;
+
+    sorted = malloc((table->count ? table->count : 1) * sizeof(*sorted));
+    if (!sorted) {
+        return -1;
+    }
+    for (size_t i = 0; i < table->count; i++) {
+        sorted[i] = &table->version[i];
+    }
+    qsort(sorted, table->count, sizeof(*sorted), version_candidate_cmp);
+
+    current = 0;
+    for (size_t i = 0; i < table->count; i++) {
+        if (i && version_cmp_parsed(sorted[i - 1], sorted[i])) {
+            current++;
+        }
+        rank[sorted[i] - table->version] = current;
+    }
+    free(sorted);
+
+    table->ranked = 1;
+    return 0;
+}
+
+/**
+ * Three-way comparison of interned versions
+ * @param table version table
+ * @param a version1 ID
+ * @param b version2 ID
+ * @return -1 if a < b
+ * @return 0 if a == b
+ * @return 1 if a > b
+ * @return VCMP_CMP_ERROR on error
+ */
+int version_table_cmp(const vcmp_table *table, int a, int b) {
+    if (!table || a < 0 || b < 0 || (size_t) a >= table->count || (size_t) b >= table->count) {
+        return VCMP_CMP_ERROR;
+    }
+    if (table->ranked) {
+        return (table->rank[a] > table->rank[b]) - (table->rank[a] < table->rank[b]);
+    }
+    return version_cmp_parsed(&table->version[a], &table->version[b]);
+}
+
+/**
+ * Compare interned versions based on flag(s)
+ * @param table version table
+ * @param flags version operators
+ * @param a version1 ID
+ * @param b version2 ID
+ * @return 1 flag operation is true
+ * @return 0 flag operation is false
+ * @return -1 on error
+ */
+int version_table_compare(const vcmp_table *table, int flags, int a, int b) {
+    if (!flags || flags < 0) {
+        return -1;
+    }
+    return version_compare_result(flags, version_table_cmp(table, a, b));
+}
+
+struct version_compare_batch {
+    int flags;
+    const char **a;
+    const char **b;
+    int *out;
+    size_t n;
+    size_t first;
+    size_t stride;
+};
+
+/**
+ * Evaluate every stride'th chunk of a batch, starting at chunk first
+ * @param arg struct version_compare_batch
+ * @return NULL
+ */
+static void *version_compare_batch_worker(void *arg) {
+    struct version_compare_batch *batch = arg;
+
+    for (size_t chunk = batch->first; chunk * VCMP_BATCH_CHUNK < batch->n; chunk += batch->stride) {
+        size_t start = chunk * VCMP_BATCH_CHUNK;
+        size_t end = start + VCMP_BATCH_CHUNK < batch->n ? start + VCMP_BATCH_CHUNK : batch->n;
+        for (size_t i = start; i < end; i++) {
+            batch->out[i] = version_compare(batch->flags, batch->a[i], batch->b[i]);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Compare arrays of version strings pairwise based on flag(s)
+ *
+ * out[i] receives version_compare(flags, a[i], b[i]). Chunks are assigned to
+ * threads round-robin, so every element is written exactly once and the
+ * output does not depend on scheduling.
+ *
+ * @param flags version operators
+ * @param a array of version1
+ * @param b array of version2
+ * @param out array of results
+ * @param n number of pairs
+ * @param threads number of threads (0 uses one per online CPU)
+ * @return 0 on success
+ * @return -1 on error
+ */
+int version_compare_many(int flags, const char **a, const char **b, int *out, size_t n, unsigned threads) {
+    struct version_compare_batch *batches;
+    pthread_t *tid;
+    int *started;
+    size_t nchunks;
+
+    if (!n) {
+        return 0;
+    }
+    if (!a || !b || !out) {
+        return -1;
+    }
+
+    if (!threads) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = ncpu > 0 ? (unsigned) ncpu : 1;
+    }
+    nchunks = (n + VCMP_BATCH_CHUNK - 1) / VCMP_BATCH_CHUNK;
+    if (threads > nchunks) {
+        threads = (unsigned) nchunks;
+    }
+
+    if (threads == 1) {
+        struct version_compare_batch batch = {flags, a, b, out, n, 0, 1};
+        version_compare_batch_worker(&batch);
+        return 0;
+    }
+
+    batches = calloc(threads, sizeof(*batches));
+    tid = calloc(threads, sizeof(*tid));
+    started = calloc(threads, sizeof(*started));
+    if (!batches || !tid || !started) {
+        free(batches);
+        free(tid);
+        free(started);
+        return -1;
+    }
+
+    for (unsigned t = 0; t < threads; t++) {
+        struct version_compare_batch batch = {flags, a, b, out, n, t, threads};
+        batches[t] = batch;
+    }
+
+    // The calling thread evaluates the first share itself
+    for (unsigned t = 1; t < threads; t++) {
+        started[t] = !pthread_create(&tid[t], NULL, version_compare_batch_worker, &batches[t]);
+    }
+    version_compare_batch_worker(&batches[0]);
+
+    for (unsigned t = 1; t < threads; t++) {
+        if (started[t]) {
+            pthread_join(tid[t], NULL);
+        } else {
+            version_compare_batch_worker(&batches[t]);
+        }
+    }
+
+    free(batches);
+    free(tid);
+    free(started);
+    return 0;
+}
+
+/**
+ * Append an unsigned integer to a sort key
+ *
+ * The byte count comes first, so a shorter number orders before a longer
+ * one, followed by the significant bytes big-endian.
+ *
+ * @param key destination
+ * @param size size of key
+ * @param pos write position, advanced past the encoded value
+ * @param value value to encode
+ */
+static void version_key_put_uint(unsigned char *key, size_t size, size_t *pos, uint64_t value) {
+    unsigned char len = 0;
+
+    for (uint64_t tmp = value; tmp; tmp >>= 8) {
+        len++;
+    }
+    if (*pos < size) {
+        key[*pos] = len;
+    }
+    (*pos)++;
+    while (len--) {
+        if (*pos < size) {
+            key[*pos] = (unsigned char) (value >> (8 * len));
+        }
+        (*pos)++;
+    }
+}
+
+/**
+ * Append a packed tag and its terminator to a sort key
+ * @param key destination
+ * @param size size of key
+ * @param pos write position, advanced past the encoded tag
+ * @param tag packed tag as produced by version_next()
+ */
+static void version_key_put_tag(unsigned char *key, size_t size, size_t *pos, uint64_t tag) {
+    for (int shift = 8 * (VCMP_TAG_MAX - 1); shift >= 0 && (tag >> shift) & 0xff; shift -= 8) {
+        if (*pos < size) {
+            key[*pos] = (unsigned char) (tag >> shift);
+        }
+        (*pos)++;
+    }
+    if (*pos < size) {
+        key[*pos] = 0;
+    }
+    (*pos)++;
+}
+
+/**
+ * Append the letters of a tag and its terminator to a sort key
+ * @param key destination
+ * @param size size of key
+ * @param pos write position, advanced past the encoded tag
+ * @param letters tag
+ * @param nletters length of the tag
+ */
+static void version_key_put_letters(unsigned char *key, size_t size, size_t *pos, const char *letters,
+                                    size_t nletters) {
+    for (size_t i = 0; i < nletters; i++) {
+        if (*pos < size) {
+            key[*pos] = (unsigned char) letters[i];
+        }
+        (*pos)++;
+    }
+    if (*pos < size) {
+        key[*pos] = 0;
+    }
+    (*pos)++;
+}
+
+/**
+ * Encode a parsed version as a memcmp-comparable sort key
+ *
+ * memcmp() over two keys of the same size orders them the same way
+ * version_cmp_parsed() orders the versions. Unused bytes are zeroed. When
+ * the return value exceeds size the key was truncated: keys that differ are
+ * still ordered correctly, but equal truncated keys need a full comparison.
+ * A key of VCMP_SORT_KEY_MAX bytes is never truncated.
+ *
+ * @param version parsed version
+ * @param key destination
+ * @param size size of key
+ * @return number of bytes needed to encode the whole version
+ */
+size_t version_sort_key(const vcmp_version *version, unsigned char *key, size_t size) {
+    size_t pos = 0;
+
+    if (size) {
+        memset(key, 0, size);
+    }
+    version_key_put_uint(key, size, &pos, version->epoch);
+    for (size_t i = 0; i < version->count; i++) {
+        version_key_put_uint(key, size, &pos, version->component[i]);
+        version_key_put_tag(key, size, &pos, version->tag[i]);
+    }
+    return pos;
+}
+
+/**
+ * Encode a version string as a sort key
+ *
+ * Produces the same key as version_sort_key() would for the parsed string,
+ * and encodes tags of any length in full.
+ *
+ * @param str version string
+ * @param key destination
+ * @param size size of key
+ * @return number of bytes needed to encode the whole version
+ * @return 0 if str is not a version, or has more than VCMP_COMPONENTS_MAX
+ * components
+ */
+static size_t version_sort_key_str(const char *str, unsigned char *key, size_t size) {
+    const char *ptr, *letters;
+    uint64_t epoch, value, tag;
+    int has_epoch;
+    size_t pos, len, nletters, count;
+
+    memset(key, 0, size);
+    ptr = version_epoch(str, NULL, &epoch, &has_epoch);
+    if (!ptr) {
+        return 0;
+    }
+
+    pos = 0;
+    version_key_put_uint(key, size, &pos, epoch);
+    len = pos;
+    count = 0;
+    while (version_next(&ptr, NULL, &value, &tag, &letters, &nletters)) {
+        if (++count > VCMP_COMPONENTS_MAX) {
+            return 0;
+        }
+        version_key_put_uint(key, size, &pos, value);
+        version_key_put_letters(key, size, &pos, letters, nletters);
+        // Trailing zero components encode as padding
+        if (value || tag) {
+            len = pos;
+        }
+    }
+    return len;
+}
+
+struct version_sort_entry {
+    unsigned char key[VCMP_SORT_KEY_SIZE];
+    const char *str;
+    size_t index;
+    unsigned char valid;
+    unsigned char exact;
+};
+
+static int version_sort_entry_cmp(const void *pa, const void *pb) {
+    const struct version_sort_entry *a = pa;
+    const struct version_sort_entry *b = pb;
+    int result;
+
+    // Strings that are not versions sort last
+    if (a->valid != b->valid) {
+        return a->valid ? -1 : 1;
+    }
+    if (!a->valid) {
+        return 0;
+    }
+
+    result = memcmp(a->key, b->key, sizeof(a->key));
+    if (!result && (!a->exact || !b->exact)) {
+        result = version_cmp(a->str, b->str);
+    }
+    return (result > 0) - (result < 0);
+}
+
+static int version_sort_entry_cmp_stable(const void *pa, const void *pb) {
+    const struct version_sort_entry *a = pa;
+    const struct version_sort_entry *b = pb;
+    int result;
+
+    result = version_sort_entry_cmp(pa, pb);
+    if (!result) {
+        result = (a->index > b->index) - (a->index < b->index);
+    }
+    return result;
+}
+
+// Below this many entries, insertion sort beats another radix pass
+#define VERSION_SORT_SMALL 16
+
+static void version_sort_swap(struct version_sort_entry *a, struct version_sort_entry *b) {
+    struct version_sort_entry tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+/**
+ * Insertion sort of a few entries
+ * @param entries entries
+ * @param n number of entries
+ * @param cmp entry comparison function
+ */
+static void version_sort_insertion(struct version_sort_entry *entries, size_t n,
+                                   int (*cmp)(const void *, const void *)) {
+    for (size_t i = 1; i < n; i++) {
+        for (size_t j = i; j && cmp(&entries[j - 1], &entries[j]) > 0; j--) {
+            version_sort_swap(&entries[j - 1], &entries[j]);
+        }
+    }
+}
+
+/**
+ * Heapsort of entries whose keys do not decide their order
+ *
+ * Used for runs of equal keys, which can be long (many copies of one
+ * version), so the comparison sort must not be quadratic.
+ *
+ * @param entries entries
+ * @param n number of entries
+ * @param cmp entry comparison function
+ */
+static void version_sort_heap(struct version_sort_entry *entries, size_t n, int (*cmp)(const void *, const void *)) {
+    if (n <= VERSION_SORT_SMALL) {
+        version_sort_insertion(entries, n, cmp);
+        return;
+    }
+    for (size_t end = n, start = n / 2; end > 1;) {
+        size_t root, child;
+
+        if (start) {
+            start--;
+        } else {
+            version_sort_swap(&entries[0], &entries[--end]);
+        }
+        for (root = start; (child = 2 * root + 1) < end; root = child) {
+            if (child + 1 < end && cmp(&entries[child], &entries[child + 1]) < 0) {
+                child++;
+            }
+            if (cmp(&entries[root], &entries[child]) >= 0) {
+                break;
+            }
+            version_sort_swap(&entries[root], &entries[child]);
+        }
+    }
+}
+
+/**
+ * Permute entries in place into 256 buckets by one key byte
+ *
+ * Kept out of line so the bucket arrays are not part of every frame of
+ * the recursion in version_sort_radix().
+ *
+ * @param entries entries
+ * @param n number of entries
+ * @param depth key byte
+ */
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+static void version_sort_partition(struct version_sort_entry *entries, size_t n, size_t depth) {
+    size_t head[256], tail[256];
+
+    memset(tail, 0, sizeof(tail));
+    for (size_t i = 0; i < n; i++) {
+        tail[entries[i].key[depth]]++;
+    }
+    for (size_t b = 0, pos = 0; b < 256; b++) {
+        head[b] = pos;
+        pos += tail[b];
+        tail[b] = pos;
+    }
+    for (size_t b = 0; b < 256; b++) {
+        while (head[b] < tail[b]) {
+            unsigned char byte = entries[head[b]].key[depth];
+
+            if (byte == b) {
+                head[b]++;
+            } else {
+                version_sort_swap(&entries[head[b]], &entries[head[byte]++]);
+            }
+        }
+    }
+}
+
+/**
+ * MSD radix sort of valid entries by their sort keys
+ * @param entries entries, equal in the first depth key bytes
+ * @param n number of entries
+ * @param depth key bytes already sorted on
+ * @param cmp entry comparison function, decides ties between equal keys
+ */
+static void version_sort_radix(struct version_sort_entry *entries, size_t n, size_t depth,
+                               int (*cmp)(const void *, const void *)) {
+    if (n <= VERSION_SORT_SMALL) {
+        version_sort_insertion(entries, n, cmp);
+        return;
+    }
+    if (depth == sizeof(entries->key)) {
+        // Equal exact keys are equal versions, only the stable sort orders them
+        for (size_t i = 0; cmp != version_sort_entry_cmp_stable && i < n; i++) {
+            if (!entries[i].exact) {
+                version_sort_heap(entries, n, cmp);
+                return;
+            }
+        }
+        if (cmp == version_sort_entry_cmp_stable) {
+            version_sort_heap(entries, n, cmp);
+        }
+        return;
+    }
+
+    version_sort_partition(entries, n, depth);
+    for (size_t i = 0, j; i < n; i = j) {
+        for (j = i + 1; j < n && entries[j].key[depth] == entries[i].key[depth]; j++) {
+        }
+        version_sort_radix(entries + i, j - i, depth + 1, cmp);
+    }
+}
+
+/**
+ * Sort entries: valid ones by key, then the ones that are not versions
+ * @param entries entries
+ * @param n number of entries
+ * @param cmp version_sort_entry_cmp or version_sort_entry_cmp_stable
+ */
+static void version_sort_entries(struct version_sort_entry *entries, size_t n,
+                                 int (*cmp)(const void *, const void *)) {
+    size_t valid = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        if (entries[i].valid) {
+            version_sort_swap(&entries[i], &entries[valid++]);
+        }
+    }
+    version_sort_radix(entries, valid, 0, cmp);
+    if (cmp == version_sort_entry_cmp_stable) {
+        version_sort_heap(entries + valid, n - valid, cmp);
+    }
+}
+
+/**
+ * Sort version strings in place using precomputed sort keys
+ * @param ctx scratch context for the keys, or NULL
+ * @param versions array of version strings
+ * @param n number of versions
+ * @param cmp entry comparison function
+ * @return 0 on success
+ * @return -1 on error
+ */
+static int version_sort_with(vcmp_context *ctx, const char **versions, size_t n,
+                             int (*cmp)(const void *, const void *)) {
+    struct version_sort_entry *entries;
+    size_t used;
+
+    if (!n) {
+        return 0;
+    }
+    if (!versions) {
+        return -1;
+    }
+
+    used = ctx ? ctx->used : 0;
+    entries = version_scratch_alloc(ctx, n * sizeof(*entries));
+    if (!entries) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        size_t len = versions[i] ? version_sort_key_str(versions[i], entries[i].key, sizeof(entries[i].key)) : 0;
+        entries[i].str = versions[i];
+        entries[i].index = i;
+        entries[i].valid = len != 0;
+        entries[i].exact = len <= sizeof(entries[i].key);
+    }
+
+    version_sort_entries(entries, n, cmp);
+
+    for (size_t i = 0; i < n; i++) {
+        versions[i] = entries[i].str;
+    }
+    version_scratch_free(ctx, entries);
+    if (ctx) {
+        ctx->used = used;
+    }
+    return 0;
+}
+
+/**
+ * Sort version strings in ascending order
+ *
+ * Each version is parsed once into a sort key, so sorting does not re-parse
+ * strings for every comparison. Strings that are not versions are moved to
+ * the end. The relative order of equal versions is unspecified.
+ *
+ * @param versions array of version strings
+ * @param n number of versions
+ * @return 0 on success
+ * @return -1 on error
+ */
+int version_sort(const char **versions, size_t n) {
+    return version_sort_with(NULL, versions, n, version_sort_entry_cmp);
+}
+
+/**
+ * Sort version strings in ascending order, keeping equal versions in their
+ * original order
+ * @see version_sort()
+ * @param versions array of version strings
+ * @param n number of versions
+ * @return 0 on success
+ * @return -1 on error
+ */
+int version_sort_stable(const char **versions, size_t n) {
+    return version_sort_with(NULL, versions, n, version_sort_entry_cmp_stable);
+}
+
+/**
+ * Sort version strings in ascending order using a scratch context
+ * @see version_sort()
+ * @param ctx scratch context
+ * @param versions array of version strings
+ * @param n number of versions
+ * @return 0 on success
+ * @return -1 on error
+ */
+int version_sort_ctx(vcmp_context *ctx, const char **versions, size_t n) {
+    if (!ctx) {
+        return -1;
+    }
+    return version_sort_with(ctx, versions, n, version_sort_entry_cmp);
+}
+
+/**
+ * Stable sort of version strings using a scratch context
+ * @see version_sort_stable()
+ * @param ctx scratch context
+ * @param versions array of version strings
+ * @param n number of versions
+ * @return 0 on success
+ * @return -1 on error
+ */
+int version_sort_stable_ctx(vcmp_context *ctx, const char **versions, size_t n) {
+    if (!ctx) {
+        return -1;
+    }
+    return version_sort_with(ctx, versions, n, version_sort_entry_cmp_stable);
+}
+
+/*
+ * Index file layout
+ *
+ * A 64-byte header followed by columns, each starting on a
+ * VCMP_INDEX_ALIGN boundary:
+ *
+ *     uint64_t epoch[count]
+ *     uint64_t component[components][count]
+ *     uint64_t tag[components][count]
+ *     uint32_t rank[count]               dense, equal versions share a rank
+ *     uint8_t  ncomponents[count]
+ *     uint8_t  has_epoch[count]
+ *     uint8_t  key[count][key_size]      version_sort_key()
+ *     uint64_t string_offset[count + 1]
+ *     char     string[string_size]       NUL-terminated originals
+ *
+ * Numbers are in host byte order, recorded in the header so a reader can
+ * reject a foreign file.
+ */
+struct version_index_header {
+    char magic[8];
+    uint32_t format;
+    uint32_t byte_order;
+    uint64_t count;
+    uint32_t components;
+    uint32_t key_size;
+    uint64_t string_size;
+    uint64_t reserved[3];
+};
+
+enum {
+    VERSION_INDEX_EPOCH,
+    VERSION_INDEX_COMPONENT,
+    VERSION_INDEX_TAG,
+    VERSION_INDEX_RANK,
+    VERSION_INDEX_NCOMPONENTS,
+    VERSION_INDEX_HAS_EPOCH,
+    VERSION_INDEX_KEY,
+    VERSION_INDEX_STRING_OFFSET,
+    VERSION_INDEX_STRING,
+    VERSION_INDEX_END,
+};
+
+/**
+ * Compute where each column of an index file starts
+ * @param header index header
+ * @param offset destination for VERSION_INDEX_END + 1 offsets (the last is the file size)
+ * @return 0 on success
+ * @return -1 if the sizes overflow
+ */
+static int version_index_layout(const struct version_index_header *header, uint64_t *offset) {
+    uint64_t size[VERSION_INDEX_END];
+    uint64_t count = header->count;
+    uint64_t pos;
+
+    if (count > (UINT64_MAX >> 16) || header->key_size > 4096 || header->string_size > (UINT64_MAX >> 16)) {
+        return -1;
+    }
+    size[VERSION_INDEX_EPOCH] = count * sizeof(uint64_t);
+    size[VERSION_INDEX_COMPONENT] = count * sizeof(uint64_t) * header->components;
+    size[VERSION_INDEX_TAG] = count * sizeof(uint64_t) * header->components;
+    size[VERSION_INDEX_RANK] = count * sizeof(uint32_t);
+    size[VERSION_INDEX_NCOMPONENTS] = count;
+    size[VERSION_INDEX_HAS_EPOCH] = count;
+    size[VERSION_INDEX_KEY] = count * header->key_size;
+    size[VERSION_INDEX_STRING_OFFSET] = (count + 1) * sizeof(uint64_t);
+    size[VERSION_INDEX_STRING] = header->string_size;
+
+    pos = sizeof(*header);
+    for (int i = 0; i < VERSION_INDEX_END; i++) {
+        pos = (pos + VCMP_INDEX_ALIGN - 1) & ~(uint64_t) (VCMP_INDEX_ALIGN - 1);
+        offset[i] = pos;
+        pos += size[i];
+    }
+    offset[VERSION_INDEX_END] = pos;
+    return 0;
+}
+
+/**
+ * Point the column pointers of an index at a mapping
+ * @param index destination
+ * @param map mapping of the whole file
+ * @param offset column offsets from version_index_layout()
+ */
+static void version_index_columns(vcmp_index *index, unsigned char *map, const uint64_t *offset) {
+    for (size_t k = 0; k < VCMP_COMPONENTS_MAX; k++) {
+        index->component[k] = NULL;
+        index->tag[k] = NULL;
+    }
+    index->epoch = (const uint64_t *) (map + offset[VERSION_INDEX_EPOCH]);
+    for (size_t k = 0; k < index->components; k++) {
+        index->component[k] = (const uint64_t *) (map + offset[VERSION_INDEX_COMPONENT]) + k * index->count;
+        index->tag[k] = (const uint64_t *) (map + offset[VERSION_INDEX_TAG]) + k * index->count;
+    }
+    index->rank = (const uint32_t *) (map + offset[VERSION_INDEX_RANK]);
+    index->ncomponents = map + offset[VERSION_INDEX_NCOMPONENTS];
+    index->has_epoch = map + offset[VERSION_INDEX_HAS_EPOCH];
+    index->key = map + offset[VERSION_INDEX_KEY];
+    index->string_offset = (const uint64_t *) (map + offset[VERSION_INDEX_STRING_OFFSET]);
+    index->string = (const char *) (map + offset[VERSION_INDEX_STRING]);
+}
+
+/**
+ * Validate versions for an index and size its columns
+ * @param versions version strings
+ * @param n number of versions
+ * @param header destination
+ * @param offset destination for the column offsets
+ * @return 0 on success
+ * @return -1 on error, or if any string is not a version
+ */
+static int version_index_prepare(const char **versions, size_t n, struct version_index_header *header,
+                                 uint64_t *offset) {
+    vcmp_version version;
+
+    if ((n && !versions) || n >= UINT32_MAX) {
+        return -1;
+    }
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, VCMP_INDEX_MAGIC, sizeof(VCMP_INDEX_MAGIC));
+    header->format = VCMP_INDEX_FORMAT;
+    header->byte_order = VCMP_INDEX_BYTE_ORDER;
+    header->count = n;
+    header->key_size = VCMP_SORT_KEY_SIZE;
+    for (size_t i = 0; i < n; i++) {
+        if (!versions[i] || version_parse(versions[i], &version) < 0) {
+            return -1;
+        }
+        if (version.count > header->components) {
+            header->components = version.count;
+        }
+        header->string_size += strlen(versions[i]) + 1;
+    }
+    if (version_index_layout(header, offset) < 0 || offset[VERSION_INDEX_END] > SIZE_MAX) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Fill in the header and columns of an index
+ * @param map zeroed memory of offset[VERSION_INDEX_END] bytes
+ * @param header from version_index_prepare()
+ * @param offset from version_index_prepare()
+ * @param versions version strings
+ * @param n number of versions
+ * @param index destination for the column pointers
+ * @return 0 on success
+ * @return -1 on error
+ */
+static int version_index_fill(unsigned char *map, const struct version_index_header *header, const uint64_t *offset,
+                              const char **versions, size_t n, vcmp_index *index) {
+    struct version_sort_entry *entries;
+    vcmp_version version;
+    size_t len;
+
+    entries = malloc((n ? n : 1) * sizeof(*entries));
+    if (!entries) {
+        return -1;
+    }
+
+    memcpy(map, header, sizeof(*header));
+    index->count = n;
+    index->components = header->components;
+    index->key_size = header->key_size;
+    version_index_columns(index, map, offset);
+
+    len = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t size = strlen(versions[i]) + 1;
+
+        version_parse(versions[i], &version);
+        ((uint64_t *) index->epoch)[i] = version.epoch;
+        for (size_t k = 0; k < index->components; k++) {
+            ((uint64_t *) index->component[k])[i] = version.component[k];
+            ((uint64_t *) index->tag[k])[i] = version.tag[k];
+        }
+        ((unsigned char *) index->ncomponents)[i] = version.count;
+        ((unsigned char *) index->has_epoch)[i] = version.has_epoch;
+        version_sort_key(&version, (unsigned char *) index->key + i * index->key_size, index->key_size);
+
+        ((uint64_t *) index->string_offset)[i] = len;
+        memcpy((char *) index->string + len, versions[i], size);
+        len += size;
+
+        memcpy(entries[i].key, index->key + i * index->key_size, sizeof(entries[i].key));
+        entries[i].str = versions[i];
+        entries[i].index = i;
+        entries[i].valid = 1;
+        entries[i].exact = version_sort_key(&version, NULL, 0) <= sizeof(entries[i].key);
+    }
+    ((uint64_t *) index->string_offset)[n] = len;
+
+    // Dense ranks, so comparing two entries is comparing two integers
+    version_sort_entries(entries, n, version_sort_entry_cmp);
+    for (size_t i = 0, rank = 0; i < n; i++) {
+        if (i && version_sort_entry_cmp(&entries[i - 1], &entries[i])) {
+            rank++;
+        }
+        ((uint32_t *) index->rank)[entries[i].index] = (uint32_t) rank;
+    }
+
+    free(entries);
+    return 0;
+}
+
+/**
+ * Build an index of pre-parsed versions in memory
+ *
+ * The layout is the same as an index file. See version_index_write().
+ *
+ * @param index destination, release with version_index_close()
+ * @param versions version strings
+ * @param n number of versions
+ * @return 0 on success
+ * @return -1 on error, or if any string is not a version
+ */
+int version_index_init(vcmp_index *index, const char **versions, size_t n) {
+    struct version_index_header header;
+    uint64_t offset[VERSION_INDEX_END + 1];
+    void *map;
+
+    if (!index) {
+        return -1;
+    }
+    memset(index, 0, sizeof(*index));
+    if (version_index_prepare(versions, n, &header, offset) < 0) {
+        return -1;
+    }
+
+    if (posix_memalign(&map, VCMP_INDEX_ALIGN, (size_t) offset[VERSION_INDEX_END])) {
+        return -1;
+    }
+    memset(map, 0, (size_t) offset[VERSION_INDEX_END]);
+    if (version_index_fill(map, &header, offset, versions, n, index) < 0) {
+        free(map);
+        memset(index, 0, sizeof(*index));
+        return -1;
+    }
+    index->map = map;
+    index->map_size = (size_t) offset[VERSION_INDEX_END];
+    index->mapped = 0;
+    return 0;
+}
+
+/**
+ * Write an index file of pre-parsed versions
+ *
+ * Every version is parsed once here, so readers never parse. The file is
+ * written next to path and renamed over it.
+ *
+ * @param path index file
+ * @param versions version strings
+ * @param n number of versions
+ * @return 0 on success
+ * @return -1 on error, or if any string is not a version
+ */
+int version_index_write(const char *path, const char **versions, size_t n) {
+    struct version_index_header header;
+    uint64_t offset[VERSION_INDEX_END + 1];
+    vcmp_index index;
+    unsigned char *map;
+    char *tmp;
+    size_t len;
+    int fd, result;
+
+    if (!path || version_index_prepare(versions, n, &header, offset) < 0) {
+        return -1;
+    }
+
+    len = strlen(path) + 32;
+    tmp = malloc(len);
+    if (!tmp) {
+        return -1;
+    }
+    snprintf(tmp, len, "%s.%ld.tmp", path, (long) getpid());
+
+    result = -1;
+    map = MAP_FAILED;
+    fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t) offset[VERSION_INDEX_END]) < 0) {
+        goto version_index_write_done;
+    }
+    map = mmap(NULL, (size_t) offset[VERSION_INDEX_END], PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        goto version_index_write_done;
+    }
+
+    if (!version_index_fill(map, &header, offset, versions, n, &index)
+        && !msync(map, (size_t) offset[VERSION_INDEX_END], MS_SYNC)
+        && !rename(tmp, path)) {
+        result = 0;
+    }
+
+version_index_write_done:
+    if (map != MAP_FAILED) {
+        munmap(map, (size_t) offset[VERSION_INDEX_END]);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (result < 0) {
+        remove(tmp);
+    }
+    free(tmp);
+    return result;
+}
+
+/**
+ * Map an index file written by version_index_write()
+ * @param index destination, release with version_index_close()
+ * @param path index file
+ * @return 0 on success
+ * @return -1 on error, or if the file is not a valid index
+ */
+int version_index_open(vcmp_index *index, const char *path) {
+    struct version_index_header header;
+    uint64_t offset[VERSION_INDEX_END + 1];
+    struct stat st;
+    void *map;
+    int fd;
+
+    if (!index || !path) {
+        return -1;
+    }
+    memset(index, 0, sizeof(*index));
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(header)) {
+        close(fd);
+        return -1;
+    }
+    map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    memcpy(&header, map, sizeof(header));
+    if (memcmp(header.magic, VCMP_INDEX_MAGIC, sizeof(VCMP_INDEX_MAGIC))
+        || header.format != VCMP_INDEX_FORMAT
+        || header.byte_order != VCMP_INDEX_BYTE_ORDER
+        || header.components > VCMP_COMPONENTS_MAX
+        || version_index_layout(&header, offset) < 0
+        || offset[VERSION_INDEX_END] != (uint64_t) st.st_size) {
+        munmap(map, (size_t) st.st_size);
+        return -1;
+    }
+
+    index->map = map;
+    index->map_size = (size_t) st.st_size;
+    index->mapped = 1;
+    index->count = (size_t) header.count;
+    index->components = header.components;
+    index->key_size = header.key_size;
+    version_index_columns(index, map, offset);
+
+    // Catch a truncated or overwritten file before it is used: readers
+    // index the component columns by ncomponents and the string pool by
+    // string_offset without checking
+    if (index->string_offset[index->count] != header.string_size) {
+        version_index_close(index);
+        return -1;
+    }
+    for (size_t i = 0; i < index->count; i++) {
+        uint64_t start = index->string_offset[i];
+        uint64_t end = index->string_offset[i + 1];
+
+        if (index->ncomponents[i] > index->components
+            || start >= end || end > header.string_size || index->string[end - 1] != '\0') {
+            version_index_close(index);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Unmap an index
+ * @param index index
+ */
+void version_index_close(vcmp_index *index) {
+    if (!index) {
+        return;
+    }
+    if (index->map && index->mapped) {
+        munmap(index->map, index->map_size);
+    } else {
+        free(index->map);
+    }
+    memset(index, 0, sizeof(*index));
+}
+
+/**
+ * Gather an indexed version
+ * @param index index
+ * @param i position
+ * @param version destination
+ * @return 0 on success
+ * @return -1 on error
+ */
+int version_index_get(const vcmp_index *index, size_t i, vcmp_version *version) {
+    if (!index || !version || i >= index->count) {
+        return -1;
+    }
+
+    memset(version, 0, sizeof(*version));
+    version->epoch = index->epoch[i];
+    version->has_epoch = index->has_epoch[i];
+    version->count = index->ncomponents[i];
+    for (size_t k = 0; k < version->count; k++) {
+        version->component[k] = index->component[k][i];
+        version->tag[k] = index->tag[k][i];
+    }
+    return 0;
+}
+
+/**
+ * Get the original string of an indexed version
+ * @param index index
+ * @param i position
+ * @return version string
+ * @return NULL on error
+ */
+const char *version_index_string(const vcmp_index *index, size_t i) {
+    if (!index || i >= index->count) {
+        return NULL;
+    }
+    return index->string + index->string_offset[i];
+}
+
+/**
+ * Three-way comparison of indexed versions
+ * @param index index
+ * @param a version1 position
+ * @param b version2 position
+ * @return -1, 0, 1 or VCMP_CMP_ERROR
+ */
+int version_index_cmp(const vcmp_index *index, size_t a, size_t b) {
+    if (!index || a >= index->count || b >= index->count) {
+        return VCMP_CMP_ERROR;
+    }
+    return (index->rank[a] > index->rank[b]) - (index->rank[a] < index->rank[b]);
+}
+
+/**
+ * Compare indexed versions based on flag(s)
+ * @param index index
+ * @param flags version operators
+ * @param a version1 position
+ * @param b version2 position
+ * @return 1 flag operation is true
+ * @return 0 flag operation is false
+ * @return -1 on error
+ */
+int version_index_compare(const vcmp_index *index, int flags, size_t a, size_t b) {
+    if (!flags || flags < 0) {
+        return -1;
+    }
+    return version_compare_result(flags, version_index_cmp(index, a, b));
+}
+
+/**
+ * Compare a column of unsigned values against one value
+ * @param column values
+ * @param n number of values (64 at most)
+ * @param value value to compare against
+ * @param lt destination bitmask, bit i is column[i] < value
+ * @param gt destination bitmask, bit i is column[i] > value
+ */
+static void version_lanes_cmp_scalar(const uint64_t *column, size_t n, uint64_t value, uint64_t *lt, uint64_t *gt) {
+    for (size_t i = 0; i < n; i++) {
+        *lt |= (uint64_t) (column[i] < value) << i;
+        *gt |= (uint64_t) (column[i] > value) << i;
+    }
+}
+
+#if defined(VCMP_HAVE_X86_SIMD)
+// SSE2 has no 64-bit compare, so it is built from 32-bit halves:
+// a > b is hi(a) > hi(b), or hi(a) == hi(b) and lo(a) > lo(b)
+__attribute__((target("sse2")))
+static void version_lanes_cmp_sse2(const uint64_t *column, size_t n, uint64_t value, uint64_t *lt, uint64_t *gt) {
+    const __m128i sign = _mm_set1_epi32(INT32_MIN);
+    const __m128i x = _mm_xor_si128(_mm_set1_epi64x((long long) value), sign);
+    size_t i;
+
+    // Flipping the sign bits makes the signed compares unsigned
+    for (i = 0; i + 2 <= n; i += 2) {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (column + i)), sign);
+        __m128i eq = _mm_cmpeq_epi32(v, x);
+        __m128i less = _mm_cmplt_epi32(v, x);
+        __m128i more = _mm_cmpgt_epi32(v, x);
+        __m128i eq_hi = _mm_shuffle_epi32(eq, _MM_SHUFFLE(3, 3, 1, 1));
+        __m128i is_lt = _mm_or_si128(_mm_shuffle_epi32(less, _MM_SHUFFLE(3, 3, 1, 1)),
+                                     _mm_and_si128(eq_hi, _mm_shuffle_epi32(less, _MM_SHUFFLE(2, 2, 0, 0))));
+        __m128i is_gt = _mm_or_si128(_mm_shuffle_epi32(more, _MM_SHUFFLE(3, 3, 1, 1)),
+                                     _mm_and_si128(eq_hi, _mm_shuffle_epi32(more, _MM_SHUFFLE(2, 2, 0, 0))));
+        *lt |= (uint64_t) (unsigned) _mm_movemask_pd(_mm_castsi128_pd(is_lt)) << i;
+        *gt |= (uint64_t) (unsigned) _mm_movemask_pd(_mm_castsi128_pd(is_gt)) << i;
+    }
+    if (i < n) {
+        uint64_t tail_lt = 0, tail_gt = 0;
+        version_lanes_cmp_scalar(column + i, n - i, value, &tail_lt, &tail_gt);
+        *lt |= tail_lt << i;
+        *gt |= tail_gt << i;
+    }
+}
+
+__attribute__((target("avx2")))
+static void version_lanes_cmp_avx2(const uint64_t *column, size_t n, uint64_t value, uint64_t *lt, uint64_t *gt) {
+    const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+    const __m256i x = _mm256_xor_si256(_mm256_set1_epi64x((long long) value), sign);
+    size_t i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (column + i)), sign);
+        *lt |= (uint64_t) (unsigned) _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(x, v))) << i;
+        *gt |= (uint64_t) (unsigned) _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, x))) << i;
+    }
+    if (i < n) {
+        uint64_t tail_lt = 0, tail_gt = 0;
+        version_lanes_cmp_sse2(column + i, n - i, value, &tail_lt, &tail_gt);
+        *lt |= tail_lt << i;
+        *gt |= tail_gt << i;
+    }
+}
+#endif
+
+/**
+ * Compare every indexed version against one version
+ *
+ * The index columns are scanned 64 rows at a time. Rows are compared column
+ * by column (epoch, then component and tag pairs) and a block stops as soon
+ * as all its rows are decided, so most scans only touch the first columns.
+ *
+ * @param index index
+ * @param flags version operators
+ * @param version version2, the right-hand side of every comparison
+ * @param mask destination of (index->count + 63) / 64 words, bit i of
+ *             mask[w] is version_compare_parsed(flags, row 64 * w + i, version)
+ * @return number of rows for which the flag operation is true
+ * @return -1 on error
+ */
+long version_index_scan(const vcmp_index *index, int flags, const vcmp_version *version, uint64_t *mask) {
+    void (*lanes_cmp)(const uint64_t *, size_t, uint64_t, uint64_t *, uint64_t *);
+    size_t columns;
+    long matches;
+    int want_lt, want_eq, want_gt;
+
+    if (!index || !version || (index->count && !mask) || !flags || flags < 0) {
+        return -1;
+    }
+    want_lt = version_compare_result(flags, -1);
+    want_eq = version_compare_result(flags, 0);
+    want_gt = version_compare_result(flags, 1);
+
+    lanes_cmp = version_lanes_cmp_scalar;
+#if defined(VCMP_HAVE_X86_SIMD)
+    switch (version_isa_current()) {
+        case VCMP_ISA_AVX2:
+            lanes_cmp = version_lanes_cmp_avx2;
+            break;
+        case VCMP_ISA_SSE2:
+            lanes_cmp = version_lanes_cmp_sse2;
+            break;
+    }
+#endif
+
+    columns = index->components > version->count ? index->components : version->count;
+    matches = 0;
+    for (size_t base = 0; base < index->count; base += 64) {
+        size_t n = index->count - base < 64 ? index->count - base : 64;
+        uint64_t valid = n == 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << n) - 1;
+        uint64_t lt = 0, gt = 0, undecided, result;
+
+        lanes_cmp(index->epoch + base, n, version->epoch, &lt, &gt);
+        undecided = valid & ~(lt | gt);
+        for (size_t k = 0; k < columns && undecided; k++) {
+            for (int is_tag = 0; is_tag < 2 && undecided; is_tag++) {
+                const uint64_t *column = is_tag ? index->tag[k] : index->component[k];
+                uint64_t value = is_tag ? version->tag[k] : version->component[k];
+                uint64_t column_lt = 0, column_gt = 0;
+
+                if (k >= index->components) {
+                    // Missing column, every row holds 0
+                    column_lt = value ? valid : 0;
+                } else {
+                    lanes_cmp(column + base, n, value, &column_lt, &column_gt);
+                }
+                lt |= undecided & column_lt;
+                gt |= undecided & column_gt;
+                undecided &= ~(column_lt | column_gt);
+            }
+        }
+
+        result = (want_lt > 0 ? lt : 0) | (want_gt > 0 ? gt : 0) | (want_eq > 0 ? undecided : 0);
+        mask[base / 64] = result;
+        matches += __builtin_popcountll(result);
+    }
+    return matches;
+}
+
+/**
+ * Build an index file from a list of versions, one per line
+ *
+ * Lines that are blank or not versions are skipped with a warning.
+ *
+ * @param input version list ("-" for stdin)
+ * @param output index file
+ * @return 0 on success
+ * @return -1 on error
+ */
+int vcmp_entry_build_index(const char *input, const char *output) {
+    char *data, *line, *next;
+    const char **versions;
+    size_t size, len, n, lineno, skipped;
+    FILE *fp;
+    int result;
+
+    fp = strcmp(input, "-") ? fopen(input, "r") : stdin;
+    if (!fp) {
+        perror(input);
+        return -1;
+    }
+
+    // Slurp the input and split it in place
+    data = NULL;
+    size = 0;
+    len = 0;
+    result = 0;
+    while (!result) {
+        size_t got;
+
+        if (len + 1 >= size) {
+            char *more = realloc(data, size ? size * 2 : 65536);
+            if (!more) {
+                result = -1;
+                break;
+            }
+            data = more;
+            size = size ? size * 2 : 65536;
+        }
+        got = fread(data + len, 1, size - len - 1, fp);
+        len += got;
+        if (!got) {
+            result = ferror(fp) ? -1 : 0;
+            break;
+        }
+    }
+    if (fp != stdin) {
+        fclose(fp);
+    }
+    if (result < 0 || !data) {
+        perror(input);
+        free(data);
+        return -1;
+    }
+    data[len] = '\0';
+
+    n = 0;
+    for (size_t i = 0; i < len; i++) {
+        n += data[i] == '\n';
+    }
+    versions = malloc((n + 1) * sizeof(*versions));
+    if (!versions) {
+        perror("unable to allocate version list");
+        free(data);
+        return -1;
+    }
+
+    n = 0;
+    lineno = 0;
+    skipped = 0;
+    for (line = data; line && *line; line = next) {
+        vcmp_version version;
+        char *end;
+
+        next = strchr(line, '\n');
+        if (next) {
+            *next++ = '\0';
+        }
+        lineno++;
+
+        vcmp_lstrip(&line);
+        end = line + vcmp_rstrip_n(line, strlen(line));
+        *end = '\0';
+        if (!*line) {
+            continue;
+        }
+        if (version_parse(line, &version) < 0) {
+            fprintf(stderr, "Skipping invalid version on line %zu: '%s'\n", lineno, line);
+            skipped++;
+            continue;
+        }
+        versions[n++] = line;
+    }
+
+    result = version_index_write(output, versions, n);
+    if (result < 0) {
+        perror(output);
+    } else {
+        printf("%zu versions indexed, %zu skipped\n", n, skipped);
+    }
+    free(versions);
+    free(data);
+    return result;
+}
+
+static void usage(const char *prog) {
+    const char *name;
+    name = strrchr(prog, '/');
+    if (!name)
+        name = prog;
+    else
+        name++;
+
+    char *examples[] = {
+            "{v} execution example:\n",
+            "    %s \"1.2.3 >  1.2.3\"\n",
+            "    0\n",
+            "    %s \"1.2.3 >= 1.2.3\"\n",
+            "    1\n",
+            "    %s \"1.2.3 <  1.2.3\"\n",
+            "    0\n",
+            "    %s \"1.2.3 <= 1.2.3\"\n",
+            "    1\n",
+            "    %s \"1.2.3 != 1.2.3\"\n",
+            "    0\n",
+            "    %s \"1.2.3 =  1.2.3\"\n",
+            "    1\n",
+            "\n",
+            "{v1} {operator} {v2} execution example:\n",
+            "    %s \"1.2.3\" \">\"  \"1.2.3\"\n",
+            "    0\n",
+            "    %s \"1.2.3\" \">=\" \"1.2.3\"\n",
+            "    1\n",
+            "    %s \"1.2.3\" \"<\"  \"1.2.3\"\n",
+            "    0\n",
+            "    %s \"1.2.3\" \"<=\" \"1.2.3\"\n",
+            "    1\n",
+            "    %s \"1.2.3\" \"!=\" \"1.2.3\"\n",
+            "    0\n",
+            "    %s \"1.2.3\" \"=\"  \"1.2.3\"\n",
+            "    1\n",
+            "\n",
+            "{v1} {constraint} execution example (',' is and, '||' is or):\n",
+            "    %s \"1.5.3\" \">=1.2, <2.0, !=1.5.3\"\n",
+            "    0\n",
+            "    %s \"3.1\" \">=1.2, <2.0 || >=3.0\"\n",
+            "    1\n",
+            "\n",
+            "--stdin execution example (one {v} per line, \"-\" is an alias):\n",
+            "    printf \"1.2.3 > 1.2.3\\n1.2.3 >= 1.2.3\\n\" | %s --stdin\n",
+            "    0\n",
+            "    1\n",
+            "\n",
+            "--file execution example (one \"{name} {v1} {operator} {v2}\" per line, failures are listed):\n",
+            "    printf \"zlib 1.2.13 >= 1.2.11\\nopenssl 1.1.1 >= 3.0\\n\" > manifest.txt\n",
+            "    %s --file manifest.txt\n",
+            "    2: openssl 1.1.1 >= 3.0\n",
+            "    1 of 2 checks failed\n",
+            "\n",
+            "--cache keeps comparison results in {path} across invocations:\n",
+            "    %s --cache /tmp/vcmp.cache \"1.2.3 >= 1.2.3\"\n",
+            "    1\n",
+            "\n",
+            "--serve answers --stdin style requests on a Unix socket (see version_compare_client):\n",
+            "    %s --serve /tmp/version_compare.sock &\n",
+            "    VERSION_COMPARE_SOCKET=/tmp/version_compare.sock version_compare_client \"1.2.3 >= 1.2.3\"\n",
+            "    1\n",
+            "\n",
+            "--build-index parses a list of versions (one per line) into an index file for version_index_open():\n",
+            "    %s --build-index versions.txt versions.idx\n",
+            "\n",
+            "--scheme orders {v} and --stdin comparisons by default, semver, pep440, debian or rpm rules:\n",
+            "    %s --scheme semver \"1.0.0-rc.1 < 1.0.0\"\n",
+            "    1\n",
+            "\n",
+            "--stats writes the library counters to stderr when done (needs a VCMP_ENABLE_STATS build)\n",
+            NULL,
+    };
+
+    printf("usage: %s [--stats] [--cache {path}] [--scheme {name}] {{v} | {v1} {operator} {v2} | {v1} {constraint} | --stdin | --file {manifest} | --serve {socket} | --build-index {in} {out}}\n", name);
+    for (int i = 0; examples[i] != NULL; i++) {
+        char *output;
+
+        output = examples[i];
+        if (strchr(examples[i], '%')) {
+            printf(output, name);
         } else {
             printf("%s", output);
         }
@@ -339,73 +5105,734 @@ void usage(char *prog) {
     puts("");
 }
 
+/**
+ * Write a comparison result to stdout with a single write(2)
+ *
+ * The one-shot command line paths print nothing else, so this avoids
+ * formatting and buffering through stdio.
+ *
+ * @param result 1, 0 or -1
+ */
+static void entry_write_result(int result) {
+    static const char *const text[] = {"-1\n", "0\n", "1\n"};
+    const char *str = text[result < 0 ? 0 : result > 0 ? 2 : 1];
 
-int entry(int argc, char *argv[]) {
-    int result, op, must_free, ntokens, die;
-    char *v1, *v2, *operator, *arg, *arg_orig, *token;
-    char *tokens[4] = {NULL, NULL, NULL, NULL};
+    fflush(stdout);
+    if (write(STDOUT_FILENO, str, strlen(str)) < 0) {
+        perror("unable to write result");
+    }
+}
 
-    if (argc < 2) {
-        fprintf(stderr, "Not enough arguments.\n");
-        usage(argv[0]);
-        return 1;
+/**
+ * Split a "{v1} {operator} {v2}" expression into spans without modifying it
+ *
+ * Tokens are separated by spaces and tabs, tokens after the third are
+ * ignored.
+ *
+ * @param expr expression
+ * @param len length of expr
+ * @param token destination for the three tokens
+ * @param token_len destination for the token lengths
+ * @return number of tokens found (less than 3 is an error)
+ */
+static int entry_tokenize_n(const char *expr, size_t len, const char *token[3], size_t token_len[3]) {
+    int ntokens;
+
+    for (ntokens = 0; ntokens < 3; ntokens++) {
+        token[ntokens] = vcmp_token_next_n(&expr, &len, &token_len[ntokens]);
+        if (!token[ntokens]) {
+            break;
+        }
     }
+    return ntokens;
+}
+
+/**
+ * Evaluate newline-delimited "{v1} {operator} {v2}" expressions under an
+ * ordering scheme
+ * @param fp input stream
+ * @param scheme one of VCMP_SCHEME_*
+ * @return 0 if every expression was valid
+ * @return -1 if any expression was invalid
+ * @see vcmp_entry_stream()
+ */
+static int entry_stream_scheme(FILE *fp, int scheme) {
+    const char *token[3];
+    char *line;
+    size_t size, token_len[3];
+    ssize_t len;
+    int die;
 
     die = 0;
-    must_free = 0;
-    if (argc < 3) {
-        int i;
-        i = 0;
-        ntokens = 0;
-        must_free = 1;
-        arg = strdup(argv[1]);
-        arg_orig = arg;
-        collapse_whitespace(&arg);
+    line = NULL;
+    size = 0;
+    while ((len = getline(&line, &size, fp)) != -1) {
+        int op, result;
 
-        for (; (token = strsep(&arg, " ")) != NULL; i++, ntokens++) {
-            tokens[i] = strdup(token);
+        if (len && line[len - 1] == '\n') {
+            line[--len] = '\0';
+        }
+        if (len && line[len - 1] == '\r') {
+            line[--len] = '\0';
+        }
+        if (vcmp_isempty(line)) {
+            continue;
         }
-        arg = arg_orig;
 
-        if (i < 3) {
-            fprintf(stderr, "Invalid version spec (missing whitespace or token?): '%s'\n", argv[1]);
-            usage(argv[0]);
+        result = -1;
+        if (entry_tokenize_n(line, (size_t) len, token, token_len) < 3) {
+            fprintf(stderr, "Invalid version spec (missing whitespace or token?): '%s'\n", line);
             die = 1;
-            goto free_tokens_and_die;
+        } else if ((op = version_parse_operator_n(token[1], token_len[1])) < 0) {
+            fprintf(stderr, "Invalid operator sequence: '%.*s'\n", (int) token_len[1], token[1]);
+            die = 1;
+        } else {
+            result = version_compare_scheme_n(scheme, op, token[0], token_len[0], token[2], token_len[2]);
         }
+        // stdout is fully buffered unless it is a terminal
+        printf("%d\n", result);
+    }
+    free(line);
 
-        v1 = tokens[0];
-        operator = tokens[1];
-        v2 = tokens[2];
-    } else {
-        collapse_whitespace(&argv[1]);
-        collapse_whitespace(&argv[2]);
-        collapse_whitespace(&argv[3]);
-        v1 = argv[1];
-        operator = argv[2];
-        v2 = argv[3];
+    if (die)
+        return -1;
+
+    return 0;
+}
+
+/**
+ * Evaluate newline-delimited "{v1} {operator} {v2}" expressions
+ *
+ * One result is written per input line. Invalid lines produce -1 so the
+ * output stays aligned with the input. Blank lines are skipped.
+ *
+ * @param fp input stream
+ * @return 0 if every expression was valid
+ * @return -1 if any expression was invalid
+ */
+int vcmp_entry_stream(FILE *fp) {
+    return entry_stream_scheme(fp, VCMP_SCHEME_DEFAULT);
+}
+
+/**
+ * Evaluate "{name} {v_installed} {operator} {v_required}" lines in place
+ *
+ * Failed checks are written to stdout as "{line number}: {line}". Blank
+ * lines and lines starting with '#' are skipped.
+ *
+ * @param data manifest contents (need not be NUL-terminated)
+ * @param size length of data
+ * @param checked destination for the number of checks evaluated
+ * @param failed destination for the number of checks that failed
+ * @return 0 if every line was valid
+ * @return -1 if any line was invalid (invalid lines count as failed)
+ */
+static int entry_manifest_eval(const char *data, size_t size, size_t *checked, size_t *failed) {
+    const char *line, *end, *next;
+    size_t lineno;
+    int die;
+
+    die = 0;
+    *checked = 0;
+    *failed = 0;
+    lineno = 0;
+    for (line = data, end = data + size; line < end; line = next) {
+        const char *ptr, *token[5];
+        size_t line_len, len, token_len[5];
+        int ntokens, op, result;
+
+        next = memchr(line, '\n', (size_t) (end - line));
+        line_len = next ? (size_t) (next - line) : (size_t) (end - line);
+        next = next ? next + 1 : end;
+        line_len = vcmp_rstrip_n(line, line_len);
+        lineno++;
+
+        // A fifth token means the line is malformed
+        ptr = line;
+        len = line_len;
+        for (ntokens = 0; ntokens < 5; ntokens++) {
+            token[ntokens] = vcmp_token_next_n(&ptr, &len, &token_len[ntokens]);
+            if (!token[ntokens]) {
+                break;
+            }
+        }
+        if (!ntokens || *token[0] == '#') {
+            continue;
+        }
+
+        (*checked)++;
+        result = -1;
+        if (ntokens != 4) {
+            fprintf(stderr, "Invalid manifest entry on line %zu (expected: name version operator version)\n", lineno);
+            die = 1;
+        } else if ((op = version_parse_operator_n(token[2], token_len[2])) < 0) {
+            fprintf(stderr, "Invalid operator sequence on line %zu: '%.*s'\n", lineno, (int) token_len[2], token[2]);
+            die = 1;
+        } else {
+            result = version_compare_n(op, token[1], token_len[1], token[3], token_len[3]);
+        }
+
+        if (result != 1) {
+            printf("%zu: %.*s\n", lineno, (int) line_len, line);
+            (*failed)++;
+        }
     }
 
-    op = version_parse_operator(operator);
-    if (op < 0) {
-        fprintf(stderr, "Invalid operator sequence: '%s'\n", operator);
-        die = 1;
-        goto free_tokens_and_die;
+    if (die)
+        return -1;
+
+    return 0;
+}
+
+/**
+ * Check every line of a manifest file against its required version
+ *
+ * The file is mapped and evaluated in place. Failed checks are written to
+ * stdout followed by a summary count.
+ *
+ * @see entry_manifest_eval()
+ * @param path manifest file
+ * @return 0 if every check passed
+ * @return 1 if any check failed
+ * @return -1 on error
+ */
+int vcmp_entry_manifest(const char *path) {
+    struct stat st;
+    size_t checked, failed;
+    char *data;
+    int fd, result;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    if (fstat(fd, &st) < 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+
+    data = NULL;
+    if (st.st_size) {
+        data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            perror(path);
+            close(fd);
+            return -1;
+        }
+        madvise(data, (size_t) st.st_size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    result = entry_manifest_eval(data, (size_t) st.st_size, &checked, &failed);
+    printf("%zu of %zu checks failed\n", failed, checked);
+
+    if (data) {
+        munmap(data, (size_t) st.st_size);
+    }
+
+    if (result < 0)
+        return -1;
+
+    return failed ? 1 : 0;
+}
+
+struct entry_client {
+    struct entry_client *prev;
+    struct entry_client *next;
+    int fd;
+    int overflow;
+    size_t in_len;
+    size_t out_len;
+    size_t out_size;
+    char *out;
+    char in[VCMP_SERVE_LINE_MAX];
+};
+
+static volatile sig_atomic_t entry_serve_stop;
+
+static void entry_serve_signal(int sig) {
+    (void) sig;
+    entry_serve_stop = 1;
+}
+
+/**
+ * Evaluate one "{v1} {operator} {v2}" request
+ * @param line request span
+ * @param len length of line
+ * @return version_compare() result, or -1 if the request is malformed
+ */
+static int entry_serve_eval(const char *line, size_t len) {
+    const char *token[4];
+    size_t token_len[4];
+    int ntokens, op;
+
+    for (ntokens = 0; ntokens < 4; ntokens++) {
+        token[ntokens] = vcmp_token_next_n(&line, &len, &token_len[ntokens]);
+        if (!token[ntokens]) {
+            break;
+        }
+    }
+    if (ntokens != 3 || (op = version_parse_operator_n(token[1], token_len[1])) < 0) {
+        return -1;
+    }
+    return version_compare_n(op, token[0], token_len[0], token[2], token_len[2]);
+}
+
+/**
+ * Queue a reply for a client
+ * @return 0 on success
+ * @return -1 on error
+ */
+static int entry_client_reply(struct entry_client *client, int result) {
+    char reply[8];
+    int len;
+
+    len = snprintf(reply, sizeof(reply), "%d\n", result);
+    if (client->out_len + (size_t) len > client->out_size) {
+        size_t size = client->out_size ? client->out_size * 2 : 4096;
+        char *out = realloc(client->out, size);
+        if (!out) {
+            return -1;
+        }
+        client->out = out;
+        client->out_size = size;
     }
+    memcpy(client->out + client->out_len, reply, (size_t) len);
+    client->out_len += (size_t) len;
+    return 0;
+}
+
+/**
+ * Answer every complete request line a client has sent
+ * @return 0 on success
+ * @return -1 on error
+ */
+static int entry_client_process(struct entry_client *client) {
+    char *line, *end, *next;
 
-    result = version_compare(op, v1, v2);
-    printf("%d\n", result);
+    line = client->in;
+    end = client->in + client->in_len;
+    while ((next = memchr(line, '\n', (size_t) (end - line))) != NULL) {
+        size_t len = (size_t) (next - line);
 
-free_tokens_and_die:
-    if (must_free) {
-        for (int i = 0; i < ntokens; i++) {
-            free(tokens[i]);
+        if (client->overflow) {
+            // Tail of a line that did not fit in the buffer
+            client->overflow = 0;
+            if (entry_client_reply(client, -1) < 0) {
+                return -1;
+            }
+        } else if (!vcmp_isempty_n(line, len) && entry_client_reply(client, entry_serve_eval(line, len)) < 0) {
+            return -1;
         }
-        free(arg);
+        line = next + 1;
     }
 
-    if (die)
+    client->in_len = (size_t) (end - line);
+    memmove(client->in, line, client->in_len);
+    if (client->in_len == sizeof(client->in)) {
+        client->overflow = 1;
+        client->in_len = 0;
+    }
+    return 0;
+}
+
+/**
+ * Read requests from a client and write back what replies it will take
+ * @param readable non-zero if the socket has data
+ * @return 0 if the client is still connected
+ * @return -1 if the client should be dropped
+ */
+static int entry_client_service(struct entry_client *client, int readable) {
+    while (readable && client->out_len < VCMP_SERVE_BACKLOG) {
+        ssize_t len = read(client->fd, client->in + client->in_len, sizeof(client->in) - client->in_len);
+        if (len == 0) {
+            return -1;
+        }
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return -1;
+            }
+            break;
+        }
+        client->in_len += (size_t) len;
+        if (entry_client_process(client) < 0) {
+            return -1;
+        }
+    }
+
+    while (client->out_len) {
+        ssize_t len = write(client->fd, client->out, client->out_len);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return -1;
+            }
+            break;
+        }
+        client->out_len -= (size_t) len;
+        memmove(client->out, client->out + len, client->out_len);
+    }
+    return 0;
+}
+
+/**
+ * Disconnect a client and unlink it from the client list
+ * @param head client list
+ */
+static void entry_client_free(struct entry_client **head, struct entry_client *client) {
+    if (client->prev) {
+        client->prev->next = client->next;
+    } else {
+        *head = client->next;
+    }
+    if (client->next) {
+        client->next->prev = client->prev;
+    }
+    close(client->fd);
+    free(client->out);
+    free(client);
+}
+
+/**
+ * Accept a pending connection
+ * @param head client list the new client is added to
+ * @return new client
+ * @return NULL if there was none, or on error
+ */
+static struct entry_client *entry_client_accept(struct entry_client **head, int listener) {
+    struct entry_client *client;
+    int fd;
+
+    fd = accept(listener, NULL, NULL);
+    if (fd < 0) {
+        return NULL;
+    }
+    client = calloc(1, sizeof(*client));
+    if (!client || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+        free(client);
+        close(fd);
+        return NULL;
+    }
+    client->fd = fd;
+    client->next = *head;
+    if (*head) {
+        (*head)->prev = client;
+    }
+    *head = client;
+    return client;
+}
+
+/**
+ * Serve "{v1} {operator} {v2}" requests over a Unix domain socket
+ *
+ * Each client sends newline-delimited requests, in the same format as
+ * --stdin, and gets one "0", "1" or "-1" line per request in order. Requests
+ * may be pipelined. Clients are multiplexed with epoll on Linux and poll()
+ * elsewhere. Runs until SIGINT or SIGTERM, then removes the socket.
+ *
+ * @param path socket path (an existing socket is replaced)
+ * @return 0 on success
+ * @return -1 on error
+ */
+int vcmp_entry_serve(const char *path) {
+    struct sockaddr_un addr;
+    struct sigaction sa;
+    struct entry_client *clients, *client;
+    int listener, result;
+#if defined(__linux__)
+    struct epoll_event ev, events[64];
+    int epfd;
+#else
+    struct entry_client **polled;
+    struct pollfd *fds;
+    size_t size;
+#endif
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path is too long: '%s'\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("socket");
         return -1;
+    }
+    unlink(path);
+    if (bind(listener, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(listener, SOMAXCONN) < 0) {
+        perror(path);
+        close(listener);
+        return -1;
+    }
+    fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK);
+
+    // No SA_RESTART, the wait below has to return on a signal
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = entry_serve_signal;
+    sigemptyset(&sa.sa_mask);
+    entry_serve_stop = 0;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    result = 0;
+    clients = NULL;
+#if defined(__linux__)
+    epfd = epoll_create1(0);
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epfd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, listener, &ev) < 0) {
+        perror("epoll");
+        result = -1;
+    }
+
+    while (!result && !entry_serve_stop) {
+        int n = epoll_wait(epfd, events, sizeof(events) / sizeof(events[0]), -1);
+        if (n < 0) {
+            if (errno != EINTR) {
+                perror("epoll_wait");
+                result = -1;
+            }
+            continue;
+        }
+
+        for (int i = 0; i < n; i++) {
+            client = events[i].data.ptr;
+            if (!client) {
+                while ((client = entry_client_accept(&clients, listener)) != NULL) {
+                    ev.events = EPOLLIN;
+                    ev.data.ptr = client;
+                    if (epoll_ctl(epfd, EPOLL_CTL_ADD, client->fd, &ev) < 0) {
+                        entry_client_free(&clients, client);
+                    }
+                }
+                continue;
+            }
+
+            // Closing a descriptor also removes it from the epoll set
+            if (entry_client_service(client, events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) < 0) {
+                entry_client_free(&clients, client);
+                continue;
+            }
+            ev.events = (client->out_len < VCMP_SERVE_BACKLOG ? EPOLLIN : 0) | (client->out_len ? EPOLLOUT : 0);
+            ev.data.ptr = client;
+            epoll_ctl(epfd, EPOLL_CTL_MOD, client->fd, &ev);
+        }
+    }
+
+    if (epfd >= 0) {
+        close(epfd);
+    }
+#else
+    fds = NULL;
+    polled = NULL;
+    size = 0;
+    while (!result && !entry_serve_stop) {
+        size_t n = 1;
+
+        for (client = clients; client; client = client->next) {
+            n++;
+        }
+        if (n > size) {
+            struct pollfd *more_fds = realloc(fds, n * 2 * sizeof(*fds));
+            struct entry_client **more_polled = realloc(polled, n * 2 * sizeof(*polled));
+            if (more_fds) {
+                fds = more_fds;
+            }
+            if (more_polled) {
+                polled = more_polled;
+            }
+            if (!more_fds || !more_polled) {
+                result = -1;
+                break;
+            }
+            size = n * 2;
+        }
+
+        fds[0].fd = listener;
+        fds[0].events = POLLIN;
+        n = 1;
+        for (client = clients; client; client = client->next, n++) {
+            polled[n] = client;
+            fds[n].fd = client->fd;
+            fds[n].events = (short) ((client->out_len < VCMP_SERVE_BACKLOG ? POLLIN : 0)
+                                     | (client->out_len ? POLLOUT : 0));
+        }
 
+        if (poll(fds, n, -1) < 0) {
+            if (errno != EINTR) {
+                perror("poll");
+                result = -1;
+            }
+            continue;
+        }
+
+        for (size_t i = 1; i < n; i++) {
+            if (fds[i].revents && entry_client_service(polled[i], fds[i].revents & (POLLIN | POLLHUP | POLLERR)) < 0) {
+                entry_client_free(&clients, polled[i]);
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            while (entry_client_accept(&clients, listener) != NULL) {
+                continue;
+            }
+        }
+    }
+    free(fds);
+    free(polled);
+#endif
+
+    while (clients) {
+        entry_client_free(&clients, clients);
+    }
+    close(listener);
+    unlink(path);
+    return result;
+}
+
+/**
+ * Run the command line interface
+ * @param name program name, for usage()
+ * @param argc number of arguments
+ * @param argv arguments (argv[0] is not used, argv is not modified)
+ * @return exit status
+ */
+static int entry_run(const char *name, int scheme, int argc, char *argv[]) {
+    int result, op;
+
+    if (argc < 2) {
+        fprintf(stderr, "Not enough arguments.\n");
+        usage(name);
+        return 1;
+    }
+
+    if (argc >= 3 && !strcmp(argv[1], "--cache")) {
+        const char *path = argv[2];
+
+        if (version_cache_init(VCMP_CACHE_DEFAULT_SIZE) < 0) {
+            perror("unable to allocate cache");
+            return -1;
+        }
+        if (version_cache_load(path) < 0) {
+            fprintf(stderr, "Ignoring invalid cache file: '%s'\n", path);
+        }
+
+        result = entry_run(name, scheme, argc - 2, &argv[2]);
+
+        if (version_cache_save(path) < 0) {
+            fprintf(stderr, "Unable to write cache file: '%s'\n", path);
+        }
+        version_cache_free();
+        return result;
+    }
+
+    if (argc >= 2 && !strcmp(argv[1], "--stats")) {
+        vcmp_stats stats;
+
+        result = entry_run(name, scheme, argc - 1, &argv[1]);
+        fflush(stdout);
+        if (version_stats_get(&stats) < 0) {
+            fprintf(stderr, "Statistics are disabled (build with VCMP_ENABLE_STATS)\n");
+            return result;
+        }
+        fprintf(stderr, "parses:           %llu\n", (unsigned long long) stats.parses);
+        fprintf(stderr, "parse failures:   %llu\n", (unsigned long long) stats.parse_failures);
+        fprintf(stderr, "bytes scanned:    %llu\n", (unsigned long long) stats.bytes_scanned);
+        fprintf(stderr, "parse cycles:     %llu\n", (unsigned long long) stats.parse_cycles);
+        fprintf(stderr, "compares:         %llu (GT %llu, LT %llu, EQ %llu, NOT %llu)\n",
+                (unsigned long long) stats.compares, (unsigned long long) stats.compares_gt,
+                (unsigned long long) stats.compares_lt, (unsigned long long) stats.compares_eq,
+                (unsigned long long) stats.compares_not);
+        fprintf(stderr, "compare failures: %llu\n", (unsigned long long) stats.compare_failures);
+        fprintf(stderr, "compare cycles:   %llu\n", (unsigned long long) stats.compare_cycles);
+        return result;
+    }
+
+    if (argc >= 3 && !strcmp(argv[1], "--scheme")) {
+        scheme = version_parse_scheme(argv[2]);
+        if (scheme < 0) {
+            fprintf(stderr, "Invalid ordering scheme: '%s'\n", argv[2]);
+            return -1;
+        }
+        return entry_run(name, scheme, argc - 2, &argv[2]);
+    }
+
+    // Constraints, manifests and the server use the default ordering
+    if (scheme != VCMP_SCHEME_DEFAULT
+        && (!strcmp(argv[1], "--file") || !strcmp(argv[1], "--serve") || !strcmp(argv[1], "--build-index")
+            || (argc == 3 && strncmp(argv[1], "--", 2)))) {
+        fprintf(stderr, "--scheme only applies to {v}, {v1} {operator} {v2} and --stdin\n");
+        usage(name);
+        return 1;
+    }
+
+    if (argc == 4 && !strcmp(argv[1], "--build-index")) {
+        return vcmp_entry_build_index(argv[2], argv[3]);
+    }
+
+    if (argc == 3 && !strcmp(argv[1], "--serve")) {
+        return vcmp_entry_serve(argv[2]);
+    }
+
+    if (argc == 3 && !strcmp(argv[1], "--file")) {
+        return vcmp_entry_manifest(argv[2]);
+    }
+
+    if (argc == 3) {
+        result = version_satisfies(argv[1], argv[2]);
+        if (result < 0) {
+            fprintf(stderr, "Invalid version or constraint: '%s' '%s'\n", argv[1], argv[2]);
+            return -1;
+        }
+        printf("%d\n", result);
+        return 0;
+    }
+
+    if (argc < 3) {
+        const char *token[3];
+        size_t token_len[3];
+
+        if (!strcmp(argv[1], "-") || !strcmp(argv[1], "--stdin")) {
+            return entry_stream_scheme(stdin, scheme);
+        }
+
+        // Tokens are spans into argv[1], nothing is copied
+        if (entry_tokenize_n(argv[1], strlen(argv[1]), token, token_len) < 3) {
+            fprintf(stderr, "Invalid version spec (missing whitespace or token?): '%s'\n", argv[1]);
+            usage(name);
+            return -1;
+        }
+
+        op = version_parse_operator_n(token[1], token_len[1]);
+        if (op < 0) {
+            fprintf(stderr, "Invalid operator sequence: '%.*s'\n", (int) token_len[1], token[1]);
+            return -1;
+        }
+        entry_write_result(version_compare_scheme_n(scheme, op, token[0], token_len[0], token[2], token_len[2]));
+        return 0;
+    }
+
+    // Leading and trailing whitespace is ignored by the parsers, so the
+    // arguments are used as-is
+    op = version_parse_operator(argv[2]);
+    if (op < 0) {
+        fprintf(stderr, "Invalid operator sequence: '%s'\n", argv[2]);
+        return -1;
+    }
+    entry_write_result(version_compare_scheme(scheme, op, argv[1], argv[3]));
     return 0;
 }
+
+int vcmp_entry(int argc, char *argv[]) {
+    return entry_run(argv[0], VCMP_SCHEME_DEFAULT, argc, argv);
+}
@@ -1,19 +1,389 @@
 #ifndef VERSION_COMPARE_VERSION_COMPARE_H
 #define VERSION_COMPARE_VERSION_COMPARE_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Thread safety
+ *
+ * Every function is reentrant. Functions that take only strings or parsed
+ * versions may be called from any number of threads at once. Objects
+ * (vcmp_table, vcmp_constraint, vcmp_candidates, vcmp_context) are not
+ * synchronized: share them read-only, or give each thread its own.
+ *
+ * Process-wide settings are the exception. Call version_set_isa(),
+ * version_cache_init() and version_cache_free() before other threads use
+ * the library. Cache lookups themselves are serialized internally.
+ *
+ * The vcmp_entry*() functions are the command line interface. They use the
+ * standard streams and the comparison cache, and are meant for one thread.
+ */
+
+#if defined(_WIN32) && defined(VCMP_SHARED)
+#if defined(VCMP_BUILDING)
+#define VCMP_API __declspec(dllexport)
+#else
+#define VCMP_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define VCMP_API __attribute__((visibility("default")))
+#else
+#define VCMP_API
+#endif
+
+/*
+ * Symbols
+ *
+ * Every exported symbol carries a vcmp_ prefix, so the library links into
+ * programs that have their own isempty() or entry(). The string helpers and
+ * the command line interface are only declared under their vcmp_ names.
+ * The version_* names below are macros for the prefixed symbols; define
+ * VCMP_NO_COMPAT before including this header to call only the vcmp_ names.
+ */
+#define version_sum                   vcmp_version_sum
+#define version_sum_n                 vcmp_version_sum_n
+#define version_parse_operator        vcmp_version_parse_operator
+#define version_parse_operator_n      vcmp_version_parse_operator_n
+#define version_has_epoch             vcmp_version_has_epoch
+#define version_parse                 vcmp_version_parse
+#define version_parse_n               vcmp_version_parse_n
+#define version_set_isa               vcmp_version_set_isa
+#define version_cmp                   vcmp_version_cmp
+#define version_cmp_n                 vcmp_version_cmp_n
+#define version_cmp_parsed            vcmp_version_cmp_parsed
+#define version_compare_result        vcmp_version_compare_result
+#define version_compare               vcmp_version_compare
+#define version_compare_n             vcmp_version_compare_n
+#define version_parse_scheme          vcmp_version_parse_scheme
+#define version_cmp_scheme            vcmp_version_cmp_scheme
+#define version_cmp_scheme_n          vcmp_version_cmp_scheme_n
+#define version_compare_scheme        vcmp_version_compare_scheme
+#define version_compare_scheme_n      vcmp_version_compare_scheme_n
+#define version_compare_parsed        vcmp_version_compare_parsed
+#define version_stats_get             vcmp_version_stats_get
+#define version_stats_reset           vcmp_version_stats_reset
+#define version_cache_init            vcmp_version_cache_init
+#define version_cache_free            vcmp_version_cache_free
+#define version_cache_stats           vcmp_version_cache_stats
+#define version_cache_load            vcmp_version_cache_load
+#define version_cache_save            vcmp_version_cache_save
+#define version_sort_key              vcmp_version_sort_key
+#define version_sort                  vcmp_version_sort
+#define version_sort_stable           vcmp_version_sort_stable
+#define version_context_init          vcmp_version_context_init
+#define version_context_free          vcmp_version_context_free
+#define version_sort_ctx              vcmp_version_sort_ctx
+#define version_sort_stable_ctx       vcmp_version_sort_stable_ctx
+#define version_constraint_parse      vcmp_version_constraint_parse
+#define version_constraint_match      vcmp_version_constraint_match
+#define version_constraint_free       vcmp_version_constraint_free
+#define version_satisfies             vcmp_version_satisfies
+#define version_satisfies_ctx         vcmp_version_satisfies_ctx
+#define version_select_max            vcmp_version_select_max
+#define version_select_min            vcmp_version_select_min
+#define version_candidates_init       vcmp_version_candidates_init
+#define version_candidates_select_max vcmp_version_candidates_select_max
+#define version_candidates_select_min vcmp_version_candidates_select_min
+#define version_candidates_free       vcmp_version_candidates_free
+#define version_table_init            vcmp_version_table_init
+#define version_table_intern          vcmp_version_table_intern
+#define version_table_find            vcmp_version_table_find
+#define version_table_string          vcmp_version_table_string
+#define version_table_get             vcmp_version_table_get
+#define version_table_rank            vcmp_version_table_rank
+#define version_table_cmp             vcmp_version_table_cmp
+#define version_table_compare         vcmp_version_table_compare
+#define version_table_free            vcmp_version_table_free
+#define version_index_init            vcmp_version_index_init
+#define version_index_write           vcmp_version_index_write
+#define version_index_open            vcmp_version_index_open
+#define version_index_close           vcmp_version_index_close
+#define version_index_get             vcmp_version_index_get
+#define version_index_string          vcmp_version_index_string
+#define version_index_cmp             vcmp_version_index_cmp
+#define version_index_compare         vcmp_version_index_compare
+#define version_index_scan            vcmp_version_index_scan
+#define version_compare_many          vcmp_version_compare_many
+#define version_parse_scalar          vcmp_version_parse_scalar
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define GT 1 << 1
 #define LT 1 << 2
 #define EQ 1 << 3
 #define NOT 1 << 4
 #define EPOCH_MOD 100
+/*
+ * Hard limits of the default ordering. Versions with more than
+ * VCMP_COMPONENTS_MAX components are rejected by every function, including
+ * version_cmp() and version_compare(). Tags longer than VCMP_TAG_MAX letters
+ * are compared in full by the string functions, and rejected by the ones
+ * that work on a vcmp_version (parsing, constraints, tables, indexes).
+ */
+#define VCMP_COMPONENTS_MAX 16
+#define VCMP_TAG_MAX 8
+#define VCMP_CMP_ERROR (-2)
+#define VCMP_ISA_AUTO 0
+#define VCMP_ISA_SCALAR 1
+#define VCMP_ISA_SSE2 2
+#define VCMP_ISA_AVX2 3
+#define VCMP_BOUND_INCLUSIVE 1
+#define VCMP_BOUND_UNBOUNDED 2
+#define VCMP_SORT_KEY_SIZE 32
+#define VCMP_SORT_KEY_MAX (9 + VCMP_COMPONENTS_MAX * (9 + VCMP_TAG_MAX + 1))
+#define VCMP_CACHE_STRING_MAX 32
+#define VCMP_CACHE_DEFAULT_SIZE 4096
+#define VCMP_CONTEXT_DEFAULT_SIZE 65536
+#define VCMP_INDEX_FORMAT 1
+#define VCMP_SCHEME_DEFAULT 0
+#define VCMP_SCHEME_SEMVER 1
+#define VCMP_SCHEME_PEP440 2
+#define VCMP_SCHEME_DEBIAN 3
+#define VCMP_SCHEME_RPM 4
+
+typedef struct {
+    uint64_t epoch;
+    uint64_t component[VCMP_COMPONENTS_MAX];
+    uint64_t tag[VCMP_COMPONENTS_MAX];
+    unsigned char count;
+    unsigned char has_epoch;
+} vcmp_version;
+
+typedef struct {
+    vcmp_version low;
+    vcmp_version high;
+    unsigned char low_flags;
+    unsigned char high_flags;
+} vcmp_interval;
+
+typedef struct {
+    vcmp_interval *interval;
+    size_t count;
+} vcmp_constraint;
+
+typedef struct {
+    const vcmp_version *version;
+    size_t *order;
+    size_t count;
+} vcmp_candidates;
+
+typedef struct {
+    char *pool;
+    size_t pool_used;
+    size_t pool_size;
+    size_t *offset;
+    uint64_t *hash;
+    vcmp_version *version;
+    uint32_t *rank;
+    size_t count;
+    size_t size;
+    int *slot;
+    size_t nslots;
+    int ranked;
+} vcmp_table;
+
+typedef struct {
+    void *map;
+    size_t map_size;
+    int mapped;
+    size_t count;
+    size_t components;
+    size_t key_size;
+    const uint64_t *epoch;
+    const uint64_t *component[VCMP_COMPONENTS_MAX];
+    const uint64_t *tag[VCMP_COMPONENTS_MAX];
+    const uint32_t *rank;
+    const unsigned char *ncomponents;
+    const unsigned char *has_epoch;
+    const unsigned char *key;
+    const uint64_t *string_offset;
+    const char *string;
+} vcmp_index;
+
+typedef struct {
+    unsigned char *arena;
+    size_t size;
+    size_t used;
+} vcmp_context;
+
+typedef struct {
+    uint64_t parses;
+    uint64_t parse_failures;
+    uint64_t bytes_scanned;
+    uint64_t parse_cycles;
+    uint64_t compares;
+    uint64_t compares_gt;
+    uint64_t compares_lt;
+    uint64_t compares_eq;
+    uint64_t compares_not;
+    uint64_t compare_failures;
+    uint64_t compare_cycles;
+} vcmp_stats;
+
+typedef struct {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t entries;
+    size_t capacity;
+} vcmp_cache_stats;
+
+VCMP_API int vcmp_isempty(const char *str);
+VCMP_API int vcmp_isempty_n(const char *s, size_t len);
+VCMP_API char *vcmp_lstrip(char **s);
+VCMP_API const char *vcmp_lstrip_n(const char *s, size_t *len);
+VCMP_API char *vcmp_rstrip(char **s);
+VCMP_API size_t vcmp_rstrip_n(const char *s, size_t len);
+VCMP_API char *vcmp_collapse_whitespace(char **s);
+VCMP_API size_t vcmp_collapse_whitespace_n(const char *s, size_t len, char *dest);
+VCMP_API const char *vcmp_token_next_n(const char **s, size_t *len, size_t *token_len);
+VCMP_API int version_sum(const char *str);
+VCMP_API int version_sum_n(const char *str, size_t len);
+VCMP_API int version_parse_operator(char *str);
+VCMP_API int version_parse_operator_n(const char *str, size_t len);
+VCMP_API int version_has_epoch(const char *str);
+VCMP_API int version_parse(const char *str, vcmp_version *version);
+VCMP_API int version_parse_n(const char *str, size_t len, vcmp_version *version);
+VCMP_API int version_set_isa(int isa);
+VCMP_API int version_cmp(const char *aa, const char *bb);
+VCMP_API int version_cmp_n(const char *aa, size_t len_a, const char *bb, size_t len_b);
+VCMP_API int version_cmp_parsed(const vcmp_version *a, const vcmp_version *b);
+VCMP_API int version_compare_result(int flags, int cmp);
+VCMP_API int version_compare(int flags, const char *aa, const char *bb);
+VCMP_API int version_compare_n(int flags, const char *aa, size_t len_a, const char *bb, size_t len_b);
+VCMP_API int version_parse_scheme(const char *name);
+VCMP_API int version_cmp_scheme(int scheme, const char *aa, const char *bb);
+VCMP_API int version_cmp_scheme_n(int scheme, const char *aa, size_t len_a, const char *bb, size_t len_b);
+VCMP_API int version_compare_scheme(int scheme, int flags, const char *aa, const char *bb);
+VCMP_API int version_compare_scheme_n(int scheme, int flags, const char *aa, size_t len_a, const char *bb, size_t len_b);
+VCMP_API int version_compare_parsed(int flags, const vcmp_version *a, const vcmp_version *b);
+VCMP_API int version_stats_get(vcmp_stats *stats);
+VCMP_API void version_stats_reset(void);
+VCMP_API int version_cache_init(size_t entries);
+VCMP_API void version_cache_free(void);
+VCMP_API void version_cache_stats(vcmp_cache_stats *stats);
+VCMP_API int version_cache_load(const char *path);
+VCMP_API int version_cache_save(const char *path);
+VCMP_API size_t version_sort_key(const vcmp_version *version, unsigned char *key, size_t size);
+VCMP_API int version_sort(const char **versions, size_t n);
+VCMP_API int version_sort_stable(const char **versions, size_t n);
+VCMP_API int version_context_init(vcmp_context *ctx, size_t size);
+VCMP_API void version_context_free(vcmp_context *ctx);
+VCMP_API int version_sort_ctx(vcmp_context *ctx, const char **versions, size_t n);
+VCMP_API int version_sort_stable_ctx(vcmp_context *ctx, const char **versions, size_t n);
+VCMP_API int version_constraint_parse(const char *expr, vcmp_constraint *constraint);
+VCMP_API int version_constraint_match(const vcmp_constraint *constraint, const vcmp_version *version);
+VCMP_API void version_constraint_free(vcmp_constraint *constraint);
+VCMP_API int version_satisfies(const char *str, const char *expr);
+VCMP_API int version_satisfies_ctx(vcmp_context *ctx, const char *str, const char *expr);
+VCMP_API int version_select_max(const vcmp_constraint *constraint, const vcmp_version *candidates, size_t n, size_t *index);
+VCMP_API int version_select_min(const vcmp_constraint *constraint, const vcmp_version *candidates, size_t n, size_t *index);
+VCMP_API int version_candidates_init(vcmp_candidates *candidates, const vcmp_version *versions, size_t n);
+VCMP_API int version_candidates_select_max(const vcmp_candidates *candidates, const vcmp_constraint *constraint, size_t *index);
+VCMP_API int version_candidates_select_min(const vcmp_candidates *candidates, const vcmp_constraint *constraint, size_t *index);
+VCMP_API void version_candidates_free(vcmp_candidates *candidates);
+VCMP_API int version_table_init(vcmp_table *table);
+VCMP_API int version_table_intern(vcmp_table *table, const char *str);
+VCMP_API int version_table_find(const vcmp_table *table, const char *str);
+VCMP_API const char *version_table_string(const vcmp_table *table, int id);
+VCMP_API const vcmp_version *version_table_get(const vcmp_table *table, int id);
+VCMP_API int version_table_rank(vcmp_table *table);
+VCMP_API int version_table_cmp(const vcmp_table *table, int a, int b);
+VCMP_API int version_table_compare(const vcmp_table *table, int flags, int a, int b);
+VCMP_API void version_table_free(vcmp_table *table);
+VCMP_API int version_index_init(vcmp_index *index, const char **versions, size_t n);
+VCMP_API int version_index_write(const char *path, const char **versions, size_t n);
+VCMP_API int version_index_open(vcmp_index *index, const char *path);
+VCMP_API void version_index_close(vcmp_index *index);
+VCMP_API int version_index_get(const vcmp_index *index, size_t i, vcmp_version *version);
+VCMP_API const char *version_index_string(const vcmp_index *index, size_t i);
+VCMP_API int version_index_cmp(const vcmp_index *index, size_t a, size_t b);
+VCMP_API int version_index_compare(const vcmp_index *index, int flags, size_t a, size_t b);
+VCMP_API long version_index_scan(const vcmp_index *index, int flags, const vcmp_version *version, uint64_t *mask);
+VCMP_API int version_compare_many(int flags, const char **a, const char **b, int *out, size_t n, unsigned threads);
+#if defined(ENABLE_TESTING)
+VCMP_API int version_parse_scalar(const char *str, vcmp_version *version);
+#endif
+VCMP_API int vcmp_entry_stream(FILE *fp);
+VCMP_API int vcmp_entry_manifest(const char *path);
+VCMP_API int vcmp_entry_serve(const char *path);
+VCMP_API int vcmp_entry_build_index(const char *input, const char *output);
+VCMP_API int vcmp_entry(int argc, char *argv[]);
+
+#ifdef __cplusplus
+}
+#endif
 
-int isempty(char *str);
-char *lstrip(char **s);
-char *rstrip(char **s);
-char *collapse_whitespace(char **s);
-int version_sum(const char *str);
-int version_parse_operator(char *str);
-int version_compare(int flags, const char *aa, const char *bb);
-int entry(int argc, char *argv[]);
+#if defined(VCMP_NO_COMPAT)
+#undef version_sum
+#undef version_sum_n
+#undef version_parse_operator
+#undef version_parse_operator_n
+#undef version_has_epoch
+#undef version_parse
+#undef version_parse_n
+#undef version_set_isa
+#undef version_cmp
+#undef version_cmp_n
+#undef version_cmp_parsed
+#undef version_compare_result
+#undef version_compare
+#undef version_compare_n
+#undef version_parse_scheme
+#undef version_cmp_scheme
+#undef version_cmp_scheme_n
+#undef version_compare_scheme
+#undef version_compare_scheme_n
+#undef version_compare_parsed
+#undef version_stats_get
+#undef version_stats_reset
+#undef version_cache_init
+#undef version_cache_free
+#undef version_cache_stats
+#undef version_cache_load
+#undef version_cache_save
+#undef version_sort_key
+#undef version_sort
+#undef version_sort_stable
+#undef version_context_init
+#undef version_context_free
+#undef version_sort_ctx
+#undef version_sort_stable_ctx
+#undef version_constraint_parse
+#undef version_constraint_match
+#undef version_constraint_free
+#undef version_satisfies
+#undef version_satisfies_ctx
+#undef version_select_max
+#undef version_select_min
+#undef version_candidates_init
+#undef version_candidates_select_max
+#undef version_candidates_select_min
+#undef version_candidates_free
+#undef version_table_init
+#undef version_table_intern
+#undef version_table_find
+#undef version_table_string
+#undef version_table_get
+#undef version_table_rank
+#undef version_table_cmp
+#undef version_table_compare
+#undef version_table_free
+#undef version_index_init
+#undef version_index_write
+#undef version_index_open
+#undef version_index_close
+#undef version_index_get
+#undef version_index_string
+#undef version_index_cmp
+#undef version_index_compare
+#undef version_index_scan
+#undef version_compare_many
+#undef version_parse_scalar
+#endif
 
 #endif //VERSION_COMPARE_VERSION_COMPARE_H
\ No newline at end of file
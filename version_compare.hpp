@@ -0,0 +1,210 @@
+#ifndef VERSION_COMPARE_VERSION_COMPARE_HPP
+#define VERSION_COMPARE_VERSION_COMPARE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include "version_compare.h"
+
+namespace vcmp {
+
+namespace detail {
+
+constexpr bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+constexpr bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+constexpr bool is_alpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+constexpr uint64_t append_digit(uint64_t value, char c) {
+    return value > (UINT64_MAX - (uint64_t) (c - '0')) / 10 ? UINT64_MAX : value * 10 + (uint64_t) (c - '0');
+}
+
+constexpr int cmp_component(uint64_t value_a, uint64_t tag_a, uint64_t value_b, uint64_t tag_b) {
+    return value_a != value_b ? (value_a < value_b ? -1 : 1)
+         : tag_a != tag_b ? (tag_a < tag_b ? -1 : 1)
+         : 0;
+}
+
+} // namespace detail
+
+// A parsed version usable in constant expressions. The representation is
+// the vcmp_version produced by version_parse(), so constants can be handed
+// straight to the C API.
+class version {
+public:
+    constexpr version() : value_() {}
+
+    constexpr version(const vcmp_version &value) : value_(value) {}
+
+    constexpr version(const char *str) : version(str, length(str)) {}
+
+    // Same grammar as version_parse(). Invalid input throws, which is a
+    // compile error in a constant expression.
+    constexpr version(const char *str, size_t len) : value_() {
+        size_t pos = 0;
+        size_t end = 0;
+        uint64_t epoch = 0;
+
+        while (pos < len && detail::is_space(str[pos])) {
+            pos++;
+        }
+        if (pos == len || !str[pos]) {
+            throw std::invalid_argument("empty version");
+        }
+
+        for (end = pos; end < len && detail::is_digit(str[end]); end++) {
+            epoch = detail::append_digit(epoch, str[end]);
+        }
+        if (end < len && str[end] == ':') {
+            value_.epoch = epoch;
+            value_.has_epoch = 1;
+            pos = end + 1;
+        }
+
+        while (true) {
+            size_t start = pos;
+            size_t taglen = 0;
+            uint64_t value = 0;
+            uint64_t tag = 0;
+            bool last = false;
+
+            for (; pos < len && detail::is_digit(str[pos]); pos++) {
+                value = detail::append_digit(value, str[pos]);
+            }
+            for (; pos < len && detail::is_alpha(str[pos]); pos++) {
+                if (taglen == VCMP_TAG_MAX) {
+                    throw std::invalid_argument("version tag too long");
+                }
+                tag |= (uint64_t) (unsigned char) str[pos] << (8 * (VCMP_TAG_MAX - 1 - taglen));
+                taglen++;
+            }
+
+            if (pos < len && (str[pos] == '.' || str[pos] == '-')) {
+                pos++;
+            } else if (pos == start) {
+                break;
+            } else if (pos == len || !detail::is_digit(str[pos])) {
+                last = true;
+            }
+
+            if (value_.count == VCMP_COMPONENTS_MAX) {
+                throw std::invalid_argument("too many version components");
+            }
+            value_.component[value_.count] = value;
+            value_.tag[value_.count] = tag;
+            value_.count++;
+            if (last) {
+                break;
+            }
+        }
+
+        while (value_.count
+               && !value_.component[value_.count - 1]
+               && !value_.tag[value_.count - 1]) {
+            value_.count--;
+        }
+    }
+
+    // Parse at run time with the library tokenizer
+    static version parse(const char *str) {
+        vcmp_version value = {};
+
+        if (version_parse(str, &value) < 0) {
+            throw std::invalid_argument("invalid version");
+        }
+        return version(value);
+    }
+
+    constexpr const vcmp_version &get() const {
+        return value_;
+    }
+
+    constexpr operator const vcmp_version &() const {
+        return value_;
+    }
+
+    // Same ordering as version_cmp_parsed()
+    constexpr int cmp(const version &other) const {
+        const vcmp_version &a = value_;
+        const vcmp_version &b = other.value_;
+        size_t count = a.count > b.count ? a.count : b.count;
+
+        if (a.epoch != b.epoch) {
+            return a.epoch < b.epoch ? -1 : 1;
+        }
+        for (size_t i = 0; i < count; i++) {
+            int result = detail::cmp_component(a.component[i], a.tag[i], b.component[i], b.tag[i]);
+            if (result) {
+                return result;
+            }
+        }
+        return 0;
+    }
+
+    // Same operator precedence as version_compare_result()
+    constexpr bool compare(int flags, const version &other) const {
+        return (flags & GT) && (flags & EQ) ? cmp(other) >= 0
+             : (flags & LT) && (flags & EQ) ? cmp(other) <= 0
+             : (flags & NOT) && (flags & EQ) ? cmp(other) != 0
+             : (flags & GT) ? cmp(other) > 0
+             : (flags & LT) ? cmp(other) < 0
+             : (flags & EQ) ? cmp(other) == 0
+             : false;
+    }
+
+private:
+    static constexpr size_t length(const char *str) {
+        size_t len = 0;
+
+        while (str[len]) {
+            len++;
+        }
+        return len;
+    }
+
+    vcmp_version value_;
+};
+
+constexpr bool operator==(const version &a, const version &b) { return a.cmp(b) == 0; }
+constexpr bool operator!=(const version &a, const version &b) { return a.cmp(b) != 0; }
+constexpr bool operator<(const version &a, const version &b) { return a.cmp(b) < 0; }
+constexpr bool operator<=(const version &a, const version &b) { return a.cmp(b) <= 0; }
+constexpr bool operator>(const version &a, const version &b) { return a.cmp(b) > 0; }
+constexpr bool operator>=(const version &a, const version &b) { return a.cmp(b) >= 0; }
+
+/**
+ * Compare a version string against a constant
+ * @param flags version operators
+ * @param str version string, parsed at run time
+ * @param required constant version
+ * @return 1 flag operation is true
+ * @return 0 flag operation is false
+ * @return -1 on error
+ */
+inline int compare(int flags, const char *str, const version &required) {
+    vcmp_version value;
+
+    if (version_parse(str, &value) < 0) {
+        return -1;
+    }
+    return version_compare_parsed(flags, &value, &required.get());
+}
+
+namespace literals {
+
+constexpr version operator""_v(const char *str, size_t len) {
+    return version(str, len);
+}
+
+} // namespace literals
+
+} // namespace vcmp
+
+#endif //VERSION_COMPARE_VERSION_COMPARE_HPP